@@ -0,0 +1,222 @@
+// 测量不同证书和密钥交换配置下完整TLS握手的开销
+//
+// 用法: handshake <rsa_crt> <rsa_key> <ecdsa_crt> <ecdsa_key> [connections] [seconds] [port]
+//
+// 对每种配置，子进程以一个处理连接的线程运行服务器，并关闭会话缓存和会话票据，
+// 父进程使用connections个线程在seconds秒内不断建立连接并完成握手后断开。
+// 结束后统计每秒握手数，以及服务器进程每次握手的CPU时间，
+// 由此得到单个核心每秒能完成的握手数，即连接风暴时每个核心的握手容量。
+//
+// 同时加载两个证书时，分别以支持ECDSA签名和只支持RSA签名的客户端握手，
+// cert列显示服务器实际使用的证书类型。
+
+#include "server.hpp"
+#include "service.hpp"
+
+#include <fmt/format.h>
+#include <openssl/ssl.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+using namespace https_server;
+
+namespace {
+
+struct Config
+{
+    // 显示的名称
+    const char* name;
+
+    // 是否加载RSA证书和ECDSA证书
+    bool rsa;
+    bool ecdsa;
+
+    // 服务器的椭圆曲线偏好
+    const char* groups;
+
+    // 客户端支持的签名算法，为空时使用OpenSSL的默认值
+    const char* client_sigalgs;
+};
+
+const Config configs[] = {
+    {"rsa2048 x25519",        true,  false, "X25519:P-256", ""},
+    {"ecdsa-p256 x25519",     false, true,  "X25519:P-256", ""},
+    {"ecdsa-p256 p256",       false, true,  "P-256:X25519", ""},
+    {"dual, ecdsa client",    true,  true,  "X25519:P-256", ""},
+    {"dual, rsa-only client", true,  true,  "X25519:P-256",
+        "rsa_pss_rsae_sha256:rsa_pkcs1_sha256"},
+};
+
+int connectTo(unsigned short port)
+{
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // 等待服务器开始监听
+    for (int i = 0; i < 50; ++i) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0)
+            return fd;
+        ::close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return -1;
+}
+
+// 完成一次完整握手，返回服务器证书的密钥类型，失败时返回空字符串
+string handshake(SSL_CTX* ctx, unsigned short port)
+{
+    int fd = connectTo(port);
+    if (fd < 0)
+        return "";
+
+    SSL* ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, fd);
+    string type;
+    if (SSL_connect(ssl) == 1) {
+        auto cert = SSL_get0_peer_certificate(ssl);
+        type = EVP_PKEY_get0_type_name(X509_get0_pubkey(cert));
+        SSL_shutdown(ssl);
+    }
+
+    SSL_free(ssl);
+    ::close(fd);
+    return type;
+}
+
+// 读取进程已使用的CPU时间（秒）
+double processCpu(pid_t pid)
+{
+    std::ifstream in(fmt::format("/proc/{}/stat", pid));
+    string field;
+    double ticks = 0;
+
+    // 第14和15个字段是用户态和内核态的时钟数
+    for (int i = 1; i <= 15 && in >> field; ++i) {
+        if (i >= 14)
+            ticks += std::stod(field);
+    }
+    return ticks / ::sysconf(_SC_CLK_TCK);
+}
+
+void run(const Config& config, char* argv[], std::size_t connections,
+        double seconds, const string& port)
+{
+    auto port_number = static_cast<unsigned short>(std::stoul(port));
+
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        Option opt;
+        if (config.rsa) {
+            opt.setCrtFilePath(argv[1]);
+            opt.setPrivateKeyFilePath(argv[2]);
+            if (config.ecdsa) {
+                opt.setEcdsaCrtFilePath(argv[3]);
+                opt.setEcdsaPrivateKeyFilePath(argv[4]);
+            }
+        } else {
+            opt.setCrtFilePath(argv[3]);
+            opt.setPrivateKeyFilePath(argv[4]);
+        }
+        opt.setGroups(config.groups);
+        opt.setPreferServerCiphers(true);
+        opt.setSessionCacheSize(0);
+        opt.setSessionTickets(false);
+        opt.setMaxHandshakes(0);
+
+        // 一个接受连接的线程和一个处理连接的线程
+        Server s("127.0.0.1", port, 2, opt);
+        s.run();
+        ::_exit(0);
+    }
+
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    if (*config.client_sigalgs)
+        SSL_CTX_set1_sigalgs_list(ctx, config.client_sigalgs);
+
+    // 等待服务器启动，不计入统计
+    ::close(connectTo(port_number));
+    auto cpu_before = processCpu(pid);
+
+    std::atomic<std::size_t> completed = 0;
+    std::atomic<std::size_t> failed = 0;
+    string cert_type;
+    std::mutex cert_mutex;
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration<double>(seconds);
+
+    for (std::size_t i = 0; i < connections; ++i) {
+        clients.emplace_back([&] {
+            while (std::chrono::steady_clock::now() < deadline) {
+                auto type = handshake(ctx, port_number);
+                if (type.empty()) {
+                    ++failed;
+                    continue;
+                }
+                if (++completed == 1) {
+                    std::lock_guard<std::mutex> lock(cert_mutex);
+                    cert_type = type;
+                }
+            }
+        });
+    }
+    for (auto& client: clients)
+        client.join();
+
+    auto elapsed = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+    auto cpu = processCpu(pid) - cpu_before;
+
+    ::kill(pid, SIGTERM);
+    int status;
+    ::waitpid(pid, &status, 0);
+    SSL_CTX_free(ctx);
+
+    auto total = static_cast<double>(completed.load());
+    if (total == 0) {
+        fmt::print("{:<24}no handshake completed\n", config.name);
+        return;
+    }
+
+    fmt::print("{:<24}{:<8}{:>14.0f}{:>16.1f}{:>16.0f}{:>8}\n", config.name, cert_type,
+            total / elapsed, cpu * 1e6 / total, total / cpu, failed.load());
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 5) {
+        fmt::print("usage: {} <rsa_crt> <rsa_key> <ecdsa_crt> <ecdsa_key> "
+                "[connections] [seconds] [port]\n", argv[0]);
+        return 1;
+    }
+
+    std::size_t connections = argc > 5 ? std::stoul(argv[5]) : 8;
+    double seconds = argc > 6 ? std::stod(argv[6]) : 5;
+    string port = argc > 7 ? argv[7] : "18892";
+
+    fmt::print("{:<24}{:<8}{:>14}{:>16}{:>16}{:>8}\n", "config", "cert",
+            "handshakes/s", "cpu us/hs", "hs/s per core", "failed");
+    for (const auto& config: configs)
+        run(config, argv, connections, seconds, port);
+    return 0;
+}
\ No newline at end of file
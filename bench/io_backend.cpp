@@ -0,0 +1,242 @@
+// 比较epoll与io_uring两种后端处理请求的开销
+//
+// 用法: io_backend <crt_file> <key_file> [connections] [requests] [port]
+//
+// 子进程运行服务器，提供与example相同的/Login（JSON）和/File（64KB文件）两种服务，
+// 父进程使用connections个长连接并发发送请求，每个连接交替请求两种服务各requests次。
+// 结束后统计服务器进程的CPU时间、上下文切换次数和read/write类系统调用数。
+//
+// 分别以默认选项和-DHTTPS_SERVER_USE_IO_URING=ON构建后运行，对比两次的结果。
+// 使用io_uring时收发数据不再经过read/write系统调用，
+// 此时syscalls/request只统计剩余的同步调用，应主要比较CPU时间。
+
+#include "server.hpp"
+#include "service.hpp"
+
+#include <fmt/format.h>
+#include <openssl/ssl.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+using namespace https_server;
+
+namespace {
+
+#if defined(ASIO_HAS_IO_URING)
+const char* backend = "io_uring";
+#else
+const char* backend = "epoll";
+#endif
+
+class JsonService : public Service {
+public:
+    virtual void handleRequest(const Request& /*req*/, Response& res) override
+    {
+        res.setContent(R"({"code":1,"err_msg":"Login successful!"})",
+                    "application/json");
+    }
+};
+
+class FileService : public Service {
+public:
+    explicit FileService(const string& path) : path_(path) {}
+
+    virtual void handleRequest(const Request& /*req*/, Response& res) override
+    {
+        res.setFile(path_, "application/octet-stream");
+    }
+
+private:
+    string path_;
+};
+
+int connectTo(unsigned short port)
+{
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // 等待服务器开始监听
+    for (int i = 0; i < 50; ++i) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0)
+            return fd;
+        ::close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return -1;
+}
+
+// 读取一个完整的响应，返回false表示连接已断开
+bool readResponse(SSL* ssl, string& pending)
+{
+    char buf[16384];
+    std::size_t header_end;
+    while ((header_end = pending.find("\r\n\r\n")) == string::npos) {
+        int n = SSL_read(ssl, buf, sizeof(buf));
+        if (n <= 0) return false;
+        pending.append(buf, n);
+    }
+
+    std::size_t content_len = 0;
+    auto pos = pending.find("content-length: ");
+    if (pos != string::npos && pos < header_end)
+        content_len = std::stoul(pending.substr(pos + 16));
+
+    std::size_t total = header_end + 4 + content_len;
+    while (pending.size() < total) {
+        int n = SSL_read(ssl, buf, sizeof(buf));
+        if (n <= 0) return false;
+        pending.append(buf, n);
+    }
+    pending.erase(0, total);
+    return true;
+}
+
+// 在一个长连接上交替请求/Login和/File，返回完成的请求数
+std::size_t runClient(SSL_CTX* ctx, unsigned short port, std::size_t requests)
+{
+    int fd = connectTo(port);
+    if (fd < 0)
+        return 0;
+
+    SSL* ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, fd);
+    std::size_t done = 0;
+    if (SSL_connect(ssl) == 1) {
+        const string login = "GET /Login HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        const string file = "GET /File HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        string pending;
+        for (; done < 2 * requests; ++done) {
+            auto& request = done % 2 == 0 ? login : file;
+            SSL_write(ssl, request.data(), request.size());
+            if (!readResponse(ssl, pending))
+                break;
+        }
+    }
+
+    SSL_free(ssl);
+    ::close(fd);
+    return done;
+}
+
+// 读取/proc/<pid>/io中的计数
+std::size_t procIo(pid_t pid, const string& key)
+{
+    std::ifstream in(fmt::format("/proc/{}/io", pid));
+    string name;
+    std::size_t value;
+    while (in >> name >> value) {
+        if (name == key + ":")
+            return value;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        fmt::print("usage: {} <crt_file> <key_file> [connections] [requests] [port]\n", 
+                argv[0]);
+        return 1;
+    }
+
+    std::size_t connections = argc > 3 ? std::stoul(argv[3]) : 64;
+    std::size_t requests = argc > 4 ? std::stoul(argv[4]) : 500;
+    string port = argc > 5 ? argv[5] : "18891";
+    auto port_number = static_cast<unsigned short>(std::stoul(port));
+
+    // 准备/File返回的文件
+    char file_path[] = "/tmp/io_backend_XXXXXX";
+    int file_fd = ::mkstemp(file_path);
+    if (file_fd < 0) {
+        fmt::print("could not create temporary file\n");
+        return 1;
+    }
+    string content(64 * 1024, 'x');
+    if (::write(file_fd, content.data(), content.size()) != 
+                static_cast<ssize_t>(content.size())) {
+        fmt::print("could not write temporary file\n");
+        return 1;
+    }
+    ::close(file_fd);
+
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        JsonService json_service;
+        FileService file_service(file_path);
+        Option opt;
+        opt.setCrtFilePath(argv[1]);
+        opt.setPrivateKeyFilePath(argv[2]);
+
+        Server s("127.0.0.1", port, 2, opt);
+        s.addService("/Login", json_service);
+        s.addService("/File", file_service);
+        s.run();
+        return 0;
+    }
+
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+
+    // 等待服务器启动，不计入统计
+    ::close(connectTo(port_number));
+    auto syscalls_before = procIo(pid, "syscr") + procIo(pid, "syscw");
+
+    std::atomic<std::size_t> completed = 0;
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t i = 0; i < connections; ++i) {
+        clients.emplace_back([&] {
+            completed += runClient(ctx, port_number, requests);
+        });
+    }
+    for (auto& client: clients)
+        client.join();
+
+    auto elapsed = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+    auto syscalls = procIo(pid, "syscr") + procIo(pid, "syscw") - syscalls_before;
+
+    ::kill(pid, SIGTERM);
+    int status;
+    rusage usage {};
+    ::wait4(pid, &status, 0, &usage);
+    ::unlink(file_path);
+    SSL_CTX_free(ctx);
+
+    auto cpu_us = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 +
+                (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+    auto total = static_cast<double>(completed.load());
+    if (total == 0) {
+        fmt::print("no request completed\n");
+        return 1;
+    }
+
+    fmt::print("backend:                {}\n", backend);
+    fmt::print("connections:            {}\n", connections);
+    fmt::print("requests:               {}\n", completed.load());
+    fmt::print("requests/sec:           {:.0f}\n", total / elapsed);
+    fmt::print("server cpu us/request:  {:.1f}\n", cpu_us / total);
+    fmt::print("context switches:       {}\n", usage.ru_nvcsw + usage.ru_nivcsw);
+    fmt::print("syscalls/request:       {:.2f}\n", syscalls / total);
+    return 0;
+}
\ No newline at end of file
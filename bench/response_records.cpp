@@ -0,0 +1,172 @@
+// 统计每个请求在服务端产生的TLS记录数与写系统调用数
+//
+// 用法: response_records <crt_file> <key_file> [requests] [port]
+//
+// 子进程运行服务器，父进程作为客户端在一个长连接上发送requests个请求，
+// 通过SSL消息回调统计收到的application data记录数。
+// asio的ssl::stream每次SSL_write之后都会将产生的记录写入socket，
+// 因此记录数也等于服务端的写系统调用数。
+
+#include "server.hpp"
+#include "service.hpp"
+
+#include <fmt/format.h>
+#include <openssl/ssl.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <csignal>
+#include <string>
+#include <thread>
+
+using std::string;
+using namespace https_server;
+
+namespace {
+
+// 与example中/Login返回大小相近的JSON响应
+class JsonService : public Service {
+public:
+    virtual void handleRequest(const Request& /*req*/, Response& res) override
+    {
+        res.setContent(R"({"code":1,"err_msg":"Login successful!"})",
+                    "application/json");
+    }
+};
+
+// 收到的application data记录数
+std::size_t received_records = 0;
+
+void onMessage(int write_p, int, int content_type, const void* buf,
+            std::size_t len, SSL*, void*)
+{
+    if (!write_p && content_type == SSL3_RT_HEADER && len > 0 &&
+        static_cast<const unsigned char*>(buf)[0] == SSL3_RT_APPLICATION_DATA)
+        ++received_records;
+}
+
+int connectTo(unsigned short port)
+{
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // 等待服务器开始监听
+    for (int i = 0; i < 50; ++i) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0)
+            return fd;
+        ::close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return -1;
+}
+
+// 读取一个完整的响应，返回false表示连接已断开
+bool readResponse(SSL* ssl, string& pending)
+{
+    char buf[16384];
+    std::size_t header_end;
+    while ((header_end = pending.find("\r\n\r\n")) == string::npos) {
+        int n = SSL_read(ssl, buf, sizeof(buf));
+        if (n <= 0) return false;
+        pending.append(buf, n);
+    }
+
+    std::size_t content_len = 0;
+    auto pos = pending.find("content-length: ");
+    if (pos != string::npos && pos < header_end)
+        content_len = std::stoul(pending.substr(pos + 16));
+
+    std::size_t total = header_end + 4 + content_len;
+    while (pending.size() < total) {
+        int n = SSL_read(ssl, buf, sizeof(buf));
+        if (n <= 0) return false;
+        pending.append(buf, n);
+    }
+    pending.erase(0, total);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        fmt::print("usage: {} <crt_file> <key_file> [requests] [port]\n", argv[0]);
+        return 1;
+    }
+
+    std::size_t requests = argc > 3 ? std::stoul(argv[3]) : 10000;
+    string port = argc > 4 ? argv[4] : "18890";
+
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        JsonService service;
+        Option opt;
+        opt.setCrtFilePath(argv[1]);
+        opt.setPrivateKeyFilePath(argv[2]);
+
+        Server s("127.0.0.1", port, 2, opt);
+        s.addService("/Login", service);
+        s.run();
+        return 0;
+    }
+
+    int fd = connectTo(static_cast<unsigned short>(std::stoul(port)));
+    if (fd < 0) {
+        fmt::print("could not connect to server\n");
+        ::kill(pid, SIGTERM);
+        return 1;
+    }
+
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+    SSL* ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, fd);
+    if (SSL_connect(ssl) != 1) {
+        fmt::print("tls handshake failed\n");
+        ::kill(pid, SIGTERM);
+        return 1;
+    }
+    SSL_set_msg_callback(ssl, onMessage);
+
+    const string request = "GET /Login HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    string pending;
+
+    // 预热，排除握手后的会话票据等记录
+    SSL_write(ssl, request.data(), request.size());
+    readResponse(ssl, pending);
+    received_records = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t i = 0; i < requests; ++i) {
+        SSL_write(ssl, request.data(), request.size());
+        if (!readResponse(ssl, pending)) {
+            fmt::print("connection closed after {} requests\n", i);
+            break;
+        }
+    }
+
+    auto elapsed = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+
+    fmt::print("requests:               {}\n", requests);
+    fmt::print("requests/sec:           {:.0f}\n", requests / elapsed);
+    fmt::print("tls records/request:    {:.2f}\n",
+                static_cast<double>(received_records) / requests);
+
+    SSL_free(ssl);
+    SSL_CTX_free(ctx);
+    ::close(fd);
+
+    ::kill(pid, SIGTERM);
+    ::waitpid(pid, nullptr, 0);
+    return 0;
+}
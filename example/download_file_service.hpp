@@ -1,16 +1,12 @@
 #pragma once
 
 #include "service.hpp"
-#include "mime_types.hpp"
 
 #include <fmt/format.h>
 
 #include <string>
-#include <fstream>
-#include <memory>
 
 using std::string;
-using std::ifstream;
 using namespace https_server;
 
 class DownloadFileService : public Service {
@@ -32,33 +28,13 @@ public:
         auto file_path = root_path + filename;
         fmt::print("file_path: {}\n", file_path);
 
-        res.setHeader("Content-Disposition", "attachment; filename=" + filename);
-
-        auto fin = std::make_shared<ifstream>();
-        fin->open(file_path, std::ios::binary | std::ios::ate);
-        if (!fin->is_open()) {
+        // ranges, Content-Length and HEAD are handled by the server,
+        // file data is sent with sendfile when kTLS is enabled
+        if (!res.setFile(file_path)) {
             res = Response::stockResponse(StatusCode::not_found);
             return;
         }
 
-        // get file size
-        std::size_t file_size = fin->tellg();
-        fmt::print("{} size: {}\n", filename, file_size);
-
-        // read and send data
-        auto extension = filename.substr(filename.find_last_of(".") + 1);
-        res.setContentProvider(file_size, mime_types::extensionToType(extension),
-            [fin](std::size_t offset, std::size_t length, DataSink& sink)
-            {
-                fin->seekg(offset);
-                while (offset < length) {
-                    char buffer[1024] = {};
-                    fin->read(buffer, sizeof(buffer));
-                    std::size_t n = fin->gcount();
-                    sink.write(buffer, n);
-                    offset += n;
-                }
-            }
-        );
+        res.setHeader("Content-Disposition", "attachment; filename=" + filename);
     }
 };
\ No newline at end of file
@@ -52,4 +52,10 @@ public:
 
         res.setContent(output, "application/json");
     }
+
+    // protobuf JSON conversion is CPU-bound, run it on the worker pool
+    virtual ServiceExecution execution() const override
+    {
+        return ServiceExecution::WorkerPool;
+    }
 };
\ No newline at end of file
@@ -34,4 +34,10 @@ public:
 
         res.setContent("Upload file successful!", "text/plain");
     }
+
+    // writing files blocks, keep it off the I/O threads
+    virtual ServiceExecution execution() const override
+    {
+        return ServiceExecution::WorkerPool;
+    }
 };
\ No newline at end of file
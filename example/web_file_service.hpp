@@ -1,16 +1,12 @@
 #pragma once
 
 #include "service.hpp"
-#include "mime_types.hpp"
 
 #include <fmt/format.h>
 
 #include <string>
-#include <fstream>
-#include <memory>
 
 using std::string;
-using std::ifstream;
 using namespace https_server;
 
 class WebFileService : public Service {
@@ -24,31 +20,9 @@ public:
 
         fmt::print("file path: {}\n", file_path);
 
-        auto fin = std::make_shared<ifstream>();
-        fin->open(file_path, std::ios::binary | std::ios::ate);
-        if (!fin->is_open()) {
+        if (!res.setFile(file_path)) {
             res = Response::stockResponse(StatusCode::not_found);
             return;
         }
-
-        std::size_t file_size = fin->tellg();
-        fmt::print("file size: {}\n", file_size);
-
-        string extension = req.unresolved_path.substr(req.unresolved_path.find_last_of(".") + 1);
-
-        // chunk data
-        res.setChunkedContentProvider(mime_types::extensionToType(extension),
-            [file_size, fin](DataSink& sink) {
-                fin->seekg(0); 
-                std::size_t offset = 0;
-                while (offset < file_size) {
-                    char buffer[1024] = {};
-                    fin->read(buffer, sizeof(buffer));
-                    std::size_t n = fin->gcount();
-                    sink.write(buffer, n);
-                    offset += n;
-                }
-                sink.done();
-            });
     }
 };
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "admission_control.hpp"
+
+namespace https_server {
+
+AdmissionControl::AdmissionControl(const Option& opt)
+    : max_connections_(opt.maxConnections()),
+      max_connections_per_thread_(opt.maxConnectionsPerThread()),
+      max_handshakes_(opt.maxHandshakes()),
+      max_handshakes_per_thread_(opt.maxHandshakesPerThread()),
+      max_requests_(opt.maxRequests()),
+      max_requests_per_thread_(opt.maxRequestsPerThread()) {}
+
+bool AdmissionControl::canAccept(const IoContextLoad& load) const
+{
+    // 只有接受连接的线程增加连接数，其它线程只会减少，
+    // 因此检查之后到连接开始之前计数不会超过限制
+    // 启用reusePort时多个线程同时接受连接，最多超出线程数个
+    return below(connections_.load(std::memory_order_relaxed), max_connections_) &&
+        below(handshakes_.load(std::memory_order_relaxed), max_handshakes_) &&
+        below(load.connections(), max_connections_per_thread_) &&
+        below(load.handshakes(), max_handshakes_per_thread_);
+}
+
+void AdmissionControl::addConnection(IoContextLoad& load)
+{
+    connections_.fetch_add(1, std::memory_order_relaxed);
+    load.addConnection();
+}
+
+void AdmissionControl::removeConnection(IoContextLoad& load)
+{
+    connections_.fetch_sub(1, std::memory_order_relaxed);
+    load.removeConnection();
+}
+
+void AdmissionControl::addHandshake(IoContextLoad& load)
+{
+    handshakes_.fetch_add(1, std::memory_order_relaxed);
+    load.addHandshake();
+}
+
+void AdmissionControl::removeHandshake(IoContextLoad& load)
+{
+    handshakes_.fetch_sub(1, std::memory_order_relaxed);
+    load.removeHandshake();
+}
+
+bool AdmissionControl::tryAddRequest(IoContextLoad& load)
+{
+    // 线程的计数只在本线程中修改，先检查再增加不会超出
+    if (!below(load.requests(), max_requests_per_thread_))
+        return false;
+
+    // 全局计数先增加再检查，超出时撤销
+    auto requests = requests_.fetch_add(1, std::memory_order_relaxed);
+    if (!below(requests, max_requests_)) {
+        requests_.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    load.addRequest();
+    return true;
+}
+
+void AdmissionControl::removeRequest(IoContextLoad& load)
+{
+    requests_.fetch_sub(1, std::memory_order_relaxed);
+    load.removeRequest();
+}
+
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "io_context_load.hpp"
+#include "option.hpp"
+
+#include <atomic>
+#include <cstddef>
+
+namespace https_server {
+
+// 过载保护，限制存活的连接数、正在握手的连接数和正在处理的请求数
+// 全局计数由所有线程共享，每个线程的计数记录在其io_context的IoContextLoad中
+// 限制来自Option::maxConnections()等选项，0表示不限制
+class AdmissionControl
+{
+public:
+    explicit AdmissionControl(const Option& opt);
+
+    AdmissionControl(const AdmissionControl&) = delete;
+    AdmissionControl& operator=(const AdmissionControl&) = delete;
+
+    // load所属的线程能否接受一个新连接
+    // 连接数和正在握手的连接数都未达到限制时返回true
+    bool canAccept(const IoContextLoad& load) const;
+
+    void addConnection(IoContextLoad& load);
+    void removeConnection(IoContextLoad& load);
+
+    void addHandshake(IoContextLoad& load);
+    void removeHandshake(IoContextLoad& load);
+
+    // 开始处理一个请求，达到限制时不计入并返回false
+    // 只能在load所属的线程中调用
+    bool tryAddRequest(IoContextLoad& load);
+    void removeRequest(IoContextLoad& load);
+
+private:
+    // 是否未达到限制，limit为0表示不限制
+    static bool below(std::size_t count, std::size_t limit)
+    {
+        return limit == 0 || count < limit;
+    }
+
+    const std::size_t max_connections_;
+    const std::size_t max_connections_per_thread_;
+    const std::size_t max_handshakes_;
+    const std::size_t max_handshakes_per_thread_;
+    const std::size_t max_requests_;
+    const std::size_t max_requests_per_thread_;
+
+    std::atomic<std::size_t> connections_ = 0;
+    std::atomic<std::size_t> handshakes_ = 0;
+    std::atomic<std::size_t> requests_ = 0;
+};
+
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "buffer_pool.hpp"
+
+using std::unique_ptr;
+
+namespace https_server {
+
+BufferPool::Buffer::Buffer(unique_ptr<char[]> data, std::size_t size)
+    : data_(std::move(data)),
+      size_(size) {}
+
+BufferPool::Buffer::Buffer(Buffer&& other) noexcept
+    : data_(std::move(other.data_)),
+      size_(other.size_) {}
+
+BufferPool::Buffer& BufferPool::Buffer::operator=(Buffer&& other) noexcept
+{
+    if (this != &other) {
+        if (data_)
+            BufferPool::release(std::move(data_), size_);
+        data_ = std::move(other.data_);
+        size_ = other.size_;
+    }
+    return *this;
+}
+
+BufferPool::Buffer::~Buffer()
+{
+    if (data_)
+        BufferPool::release(std::move(data_), size_);
+}
+
+BufferPool::FreeLists& BufferPool::freeLists()
+{
+    // 每个io_context线程拥有独立的池，借出和归还都不需要加锁
+    thread_local FreeLists free_lists;
+    return free_lists;
+}
+
+BufferPool::Buffer BufferPool::acquire(std::size_t size_hint)
+{
+    auto size = size_hint > small_buffer_size 
+                ? large_buffer_size : small_buffer_size;
+    auto& list = size == small_buffer_size 
+                ? freeLists().small : freeLists().large;
+
+    if (list.empty())
+        return Buffer(unique_ptr<char[]>(new char[size]), size);
+
+    auto data = std::move(list.back());
+    list.pop_back();
+    return Buffer(std::move(data), size);
+}
+
+void BufferPool::release(unique_ptr<char[]> data, std::size_t size)
+{
+    auto& list = size == small_buffer_size 
+                ? freeLists().small : freeLists().large;
+
+    if (list.size() < max_cached_buffers)
+        list.push_back(std::move(data));
+}
+
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace https_server {
+
+// 线程局部的读缓冲区池
+// 连接只在读操作进行时持有缓冲区，空闲时将缓冲区归还给当前线程的池，
+// 大量空闲的长连接因此不再各自占用一块读缓冲区
+class BufferPool
+{
+public:
+    // 小缓冲区，用于读取请求头部和较小的请求体
+    static constexpr std::size_t small_buffer_size = 8192;
+
+    // 大缓冲区，用于读取较大的请求体
+    // 一次TLS读操作最多返回一个记录的明文，即16KB
+    static constexpr std::size_t large_buffer_size = 16384;
+
+    // 从池中借出的缓冲区，析构时自动归还
+    class Buffer
+    {
+    public:
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(Buffer&& other) noexcept;
+
+        ~Buffer();
+
+        char* data() const { return data_.get(); }
+
+        std::size_t size() const { return size_; }
+
+    private:
+        friend class BufferPool;
+
+        Buffer(std::unique_ptr<char[]> data, std::size_t size);
+
+        std::unique_ptr<char[]> data_;
+
+        std::size_t size_;
+    };
+
+    // 从当前线程的池中借出一个缓冲区
+    // size_hint: 预计需要读取的数据长度，超过small_buffer_size时借出大缓冲区
+    static Buffer acquire(std::size_t size_hint = 0);
+
+private:
+    // 每种缓冲区在一个线程中最多缓存的数量，超出的部分直接释放
+    static constexpr std::size_t max_cached_buffers = 64;
+
+    struct FreeLists
+    {
+        std::vector<std::unique_ptr<char[]>> small;
+        std::vector<std::unique_ptr<char[]>> large;
+    };
+
+    static FreeLists& freeLists();
+
+    // 将缓冲区归还给当前线程的池
+    static void release(std::unique_ptr<char[]> data, std::size_t size);
+};
+
+} // namespace https_server
\ No newline at end of file
@@ -1,7 +1,16 @@
 #include "connection.hpp"
 #include "result_type.hpp"
 
+#include <fmt/format.h>
+
 #include <vector>
+#include <algorithm>
+#include <string_view>
+
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
 
 using asio::ip::tcp;
 using std::vector;
@@ -9,7 +18,6 @@ using std::string;
 using asio::buffer;
 using asio::const_buffer;
 using asio::ssl::stream_base;
-using asio::steady_timer;
 using std::error_code;
 using asio::awaitable;
 using asio::co_spawn;
@@ -19,37 +27,60 @@ using asio::redirect_error;
 
 namespace https_server {
 
+namespace {
+
+// 过载时的响应，不经过RequestHandler，避免额外的开销
+const std::string_view overloaded_response =
+	"HTTP/1.1 503 Service Unavailable\r\n"
+	"Content-Length: 0\r\n"
+	"Retry-After: 1\r\n"
+	"Connection: close\r\n"
+	"\r\n";
+
+} // namespace
+
 Connection::Connection(asio::io_context& io_context,
-    asio::ssl::context& context,
+    tcp::socket socket,
+    std::shared_ptr<asio::ssl::context> context,
     RequestHandler& handler,
+	AdmissionControl& admission,
 	const Option& opt)
-    : socket_(io_context, context),
-	  timer_(socket_.get_executor()),
+    : req_parser_(RequestParser(opt)),
       req_handler_(handler),
-	  req_parser_(RequestParser(opt)),
-	  opt_(opt)
+      ssl_context_(std::move(context)),
+      socket_(std::move(socket), *ssl_context_),
+	  timer_wheel_(asio::use_service<TimerWheel>(io_context)),
+	  load_(asio::use_service<IoContextLoad>(io_context)),
+	  admission_(admission),
+	  manager_(asio::use_service<ConnectionManager>(io_context)),
+	  deadline_([this] { stop(); }),
+	  opt_(opt) {}
+
+Connection::~Connection()
 {
-	timer_.expires_at(steady_timer::time_point::max());
+	// 连接关闭时不发送close_notify，这里将连接标记为已关闭，
+	// 否则OpenSSL释放连接时会把会话当作异常断开，从会话缓存中移除
+	::SSL_set_shutdown(socket_.native_handle(), 
+			SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+
+	admission_.removeConnection(load_);
 }
 
 void Connection::start() {
-	if (opt_.connectionTimeout() != 0) {
-		// 启动一个协程执行定时器到期操作
-		co_spawn(timer_.get_executor(), 
-			[this, self = shared_from_this()] { return self->doDeadline(timer_); },
-			detached);
-
-		timer_.expires_after(std::chrono::seconds(opt_.connectionTimeout()));
-	}
-
-    // 启动一个协程进行ssl握手操作
+    // 启动一个协程进行ssl握手操作，握手成功后在同一个协程中读取请求
+	// 协程无论正常结束还是因异常退出，都在完成时从连接管理器中移除，
+	// 避免连接释放后管理器中留下悬空的指针
 	co_spawn(socket_.get_executor(), 
 		[self = shared_from_this()] { return self->doHandshake(); }, 
-		detached);
+		[self = shared_from_this()](std::exception_ptr e) {
+			if (e)
+				self->stop();
+			self->release();
+		});
 }
 
 void Connection::stop() {
-	timer_.cancel();
+	timer_wheel_.cancel(deadline_);
 
 	asio::error_code ignored_ec;
 	socket_.lowest_layer().shutdown(tcp::socket::shutdown_both,
@@ -57,76 +88,266 @@ void Connection::stop() {
 	socket_.lowest_layer().close();
 }
 
+void Connection::drain()
+{
+	if (http2_) {
+		http2_->drain();
+		return;
+	}
+
+	bool waiting = phase_ == Phase::handshake || phase_ == Phase::idle ||
+		(phase_ == Phase::header && req_parser_.isIdle());
+	if (waiting)
+		stop();
+}
+
+void Connection::release()
+{
+	timer_wheel_.cancel(deadline_);
+	manager_.remove(this);
+}
+
 ssl_socket::lowest_layer_type& Connection::socket()
 {
 	return socket_.lowest_layer();
 }
 
+bool Connection::peerClosed()
+{
+	auto& sock = socket_.lowest_layer();
+	if (!sock.is_open())
+		return true;
+
+	// 收到FIN时recv返回0，收到RST时返回错误
+	// 仍有未读取的数据（如流水线请求）时认为连接正常
+	char c;
+	auto n = ::recv(sock.native_handle(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+	if (n == 0)
+		return true;
+	return n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+}
+
 void Connection::reset()
 {
 	req_ = Request();
 	res_ = Response();
 	req_parser_.reset();
+	head_written_ = false;
 }
 
-awaitable<void> Connection::doDeadline(steady_timer& timer)
+void Connection::setDeadline(TimerWheel::clock_type::duration timeout)
 {
-	while (true) {
-		co_await timer.async_wait(use_awaitable);
+	if (timeout == TimerWheel::clock_type::duration::zero())
+		timer_wheel_.cancel(deadline_);
+	else
+		timer_wheel_.arm(deadline_, timeout);
+}
 
-		if (!socket_.lowest_layer().is_open())
-			break;
+void Connection::enterPhase(Phase phase)
+{
+	if (phase == phase_ && phase != Phase::write)
+		return;
+	phase_ = phase;
 
-		// 检查期限是否已过。
-		// 这里比较最后期限，因为deadline会被移动
-		if (timer.expiry() <= steady_timer::clock_type::now()) {
-			// 关闭闲置连接
-			stop();
-			break;
+	std::size_t timeout = 0;
+	switch (phase) {
+	case Phase::handshake:
+		timeout = opt_.handshakeTimeout();
+		break;
+	case Phase::header:
+		timeout = opt_.requestHeaderTimeout();
+		break;
+	case Phase::body:
+		timeout = opt_.requestBodyTimeout();
+		body_start_ = TimerWheel::clock_type::now();
+		body_received_ = 0;
+		break;
+	case Phase::write:
+		timeout = opt_.connectionTimeout();
+		break;
+	case Phase::idle:
+		timeout = opt_.idleTimeout();
+		break;
+	}
+	setDeadline(std::chrono::seconds(timeout));
+}
+
+void Connection::updateReadPhase(std::size_t bytes_read)
+{
+	if (req_parser_.isParsingBody()) {
+		if (phase_ != Phase::body) {
+			enterPhase(Phase::body);
+			return;
 		}
+
+		// 每收到min_rate字节，期限延长1秒
+		auto min_rate = opt_.requestBodyMinRate();
+		if (min_rate == 0 || opt_.requestBodyTimeout() == 0)
+			return;
+
+		body_received_ += bytes_read;
+		auto deadline = body_start_ 
+			+ std::chrono::seconds(opt_.requestBodyTimeout())
+			+ std::chrono::milliseconds(body_received_ * 1000 / min_rate);
+		auto now = TimerWheel::clock_type::now();
+		if (deadline > now)
+			setDeadline(deadline - now);
+	} else if (!req_parser_.isIdle()) {
+		// 收到新请求的第一个字节时开始计时
+		enterPhase(Phase::header);
+	} else if (phase_ == Phase::write) {
+		enterPhase(Phase::idle);
 	}
 }
 
 awaitable<void> Connection::doHandshake() {
+	setDeadline(std::chrono::seconds(opt_.handshakeTimeout()));
+	manager_.add(this);
+
+	if (opt_.ktls())
+		ktls::attach(socket_.native_handle(), ktls_state_);
+
 	error_code ec;
 	co_await socket_.async_handshake(stream_base::server,
 								redirect_error(use_awaitable, ec));
+	admission_.removeHandshake(load_);
 	if (!ec) {
-		// 启动一个协程等待读取数据
-		co_spawn(socket_.get_executor(), 
-			[self = shared_from_this()] { return self->doRead(); }, 
-			detached);
-	} else if (ec != asio::error::operation_aborted) {
+		// 统计会话恢复的命中率
+		SessionResumption::recordHandshake(socket_.native_handle());
+
+		// 尝试将发送方向的加密交给内核，失败时继续使用OpenSSL
+		if (opt_.ktls()) {
+			ktls_tx_ = ktls::enableTx(socket_.native_handle(),
+						socket_.lowest_layer().native_handle(), ktls_state_);
+		}
+
+		// 等待第一个请求的时间计入头部超时
+		enterPhase(Phase::header);
+
+		// 客户端通过ALPN选择了HTTP/2，由HTTP/2会话处理之后的所有请求
+		if (Http2Session::negotiated(socket_.native_handle())) {
+			http2_ = std::make_unique<Http2Session>(*this);
+			co_await http2_->run();
+			co_return;
+		}
+
+		// 直接等待读取数据，不再另外启动协程，
+		// 每个连接只需一次co_spawn，减少协程帧和调度相关的内存分配
+		co_await doRead();
+	} else {
 		// ssl握手失败，断开本次连接
-		this->stop();
+		if (ec != asio::error::operation_aborted)
+			this->stop();
 	}
 }
 
 awaitable<void> Connection::doRead() {
+	// 上次读取是否填满了缓冲区
+	bool buffer_filled = false;
 	while (true) {
 		if (!socket_.lowest_layer().is_open())
 			break;
 
 		error_code ec;
-		std::size_t n = co_await socket_.async_read_some(buffer(buffer_),
+
+		// 连接空闲时只等待socket可读，不持有读缓冲区
+		// 上次读取填满了缓冲区时，asio的ssl::stream内部可能还缓存着
+		// 尚未写入BIO的密文，此时socket不一定可读，应直接读取
+		if (!buffer_filled && !hasPendingTlsData()) {
+			co_await socket_.lowest_layer().async_wait(tcp::socket::wait_read,
+									redirect_error(use_awaitable, ec));
+			if (ec) {
+				if (ec != asio::error::operation_aborted)
+					this->stop();
+				continue;
+			}
+		}
+
+		// 有数据到达，从当前线程的池中借出缓冲区
+		// 正在读取较大的请求体时借出大缓冲区
+		auto buf = BufferPool::acquire(req_parser_.remainingContentLength());
+		std::size_t n = co_await socket_.async_read_some(
+									buffer(buf.data(), buf.size()),
 									redirect_error(use_awaitable, ec));
+		buffer_filled = !ec && n == buf.size();
 
 		if (!ec) {
-			// 解析HTTP消息
-			ResultType result;
-			std::tie(result, std::ignore) = req_parser_.parse(
-					req_, res_, buffer_.data(), buffer_.data() + n);
-			// cout << string(buffer_.data(), buffer_.data() + n) << endl;
-			if (result == good) {
-				// HTTP消息符合规范，开始处理请求
-				req_.remote_addr = socket_.lowest_layer().remote_endpoint().address().to_string();
-    			req_handler_.handleRequest(*this, req_, res_);
-				reset();
-    		} else if (result == bad) {
-				// HTTP消息解析失败
-				req_handler_.writeStockResponseWithStatus(*this, res_.status);
+			// 一次读取的数据中可能包含多个流水线请求，
+			// 依次解析并按顺序响应，直到数据全部被消费
+			char* begin = buf.data();
+			char* end = buf.data() + n;
+			bool parse_failed = false;
+			bool overloaded = false;
+			bool draining = false;
+			bool service_failed = false;
+			while (begin != end) {
+				// 解析HTTP消息
+				ResultType result;
+				std::tie(result, begin) = req_parser_.parse(
+						req_, res_, begin, end);
+				if (result == good) {
+					enterPhase(Phase::write);
+
+					// 正在处理的请求过多，不处理本请求，
+					// 直接发送预先生成的503响应并关闭连接
+					if (!admission_.tryAddRequest(load_)) {
+						co_await asyncWrite(overloaded_response.data(),
+										overloaded_response.size());
+						overloaded = true;
+						break;
+					}
+
+					// HTTP消息符合规范，开始处理请求
+					error_code ignored_ec;
+					req_.remote_addr = socket_.lowest_layer()
+						.remote_endpoint(ignored_ec).address().to_string();
+					// 服务抛出的异常不能越过这里，否则请求计数无法归还
+					bool failed = false;
+					try {
+						co_await req_handler_.handleRequest(*this, req_, res_);
+					} catch (...) {
+						failed = true;
+					}
+					admission_.removeRequest(load_);
+
+					// 响应还未开始时发送500，响应可能不完整，之后关闭连接
+					if (failed) {
+						if (!head_written_) {
+							co_await req_handler_.writeStockResponseWithStatus(*this,
+											StatusCode::internal_server_error);
+						}
+						service_failed = true;
+						break;
+					}
+					reset();
+
+					// 服务器即将停止，响应中已经带有Connection: close，
+					// 不再处理后续的流水线请求
+					if (req_handler_.draining()) {
+						draining = true;
+						break;
+					}
+				} else if (result == bad) {
+					// HTTP消息解析失败
+					co_await req_handler_.writeStockResponseWithStatus(*this, res_.status);
+					parse_failed = true;
+					break;
+				}
+			}
+
+			// 本次读取的请求全部处理完毕，一次性发送合并后的响应
+			if (!co_await flush() || parse_failed || overloaded || service_failed)
 				break;
-    		}
+
+			if (draining) {
+				stop();
+				break;
+			}
+
+			// 连接即将进入空闲状态，释放输出缓冲区占用的内存
+			std::string().swap(write_buffer_);
+
+			updateReadPhase(n);
 		} else if (ec != asio::error::operation_aborted) {
 			// 读取错误，断开连接并退出循环
 			this->stop();
@@ -135,18 +356,198 @@ awaitable<void> Connection::doRead() {
 	}
 }
 
-bool Connection::doWrite(const char* data, std::size_t len)
+bool Connection::hasPendingTlsData()
+{
+	SSL* ssl = socket_.native_handle();
+
+	// SSL内部已解密或未处理的数据，以及asio写入BIO但尚未被SSL读取的数据
+	return ::SSL_pending(ssl) > 0 || ::SSL_has_pending(ssl) ||
+		::BIO_ctrl_pending(::SSL_get_rbio(ssl)) > 0;
+}
+
+void Connection::serializeHead(const Response& res, string& out)
+{
+	// 状态行
+	out += status_code::statusToResponseHeader(res.status);
+
+	// 头部信息
+	for (auto& h: res.headers) {
+		out += h.name;
+		out.append(name_value_separator_, 2);
+		out += h.value;
+		out.append(crlf_, 2);
+	}
+
+	// 空行
+	out.append(crlf_, 2);
+}
+
+awaitable<bool> Connection::writeHead(const Response& res)
+{
+	string data;
+	serializeHead(res, data);
+	head_written_ = true;
+	co_return co_await asyncWrite(data.c_str(), data.size());
+}
+
+awaitable<bool> Connection::writeChunk(const char* data, std::size_t len)
+{
+	auto size_line = fmt::format("{:x}\r\n", len);
+	co_return co_await asyncWrite(size_line.c_str(), size_line.size()) &&
+		co_await asyncWrite(data, len) &&
+		co_await asyncWrite(crlf_, 2);
+}
+
+awaitable<bool> Connection::writeLastChunk()
+{
+	static const string done_marker("0\r\n\r\n");
+	co_return co_await asyncWrite(done_marker.c_str(), done_marker.size());
+}
+
+awaitable<bool> Connection::asyncWrite(const char* data, std::size_t len)
+{
+	// 缓冲区未满，等待与后续数据合并发送
+	if (write_buffer_.size() + len < opt_.writeBufferSize()) {
+		write_buffer_.append(data, len);
+		co_return true;
+	}
+
+	// 数据较小时复制到缓冲区后一次写出
+	if (len < opt_.writeBufferSize()) {
+		write_buffer_.append(data, len);
+		co_return co_await flush();
+	}
+
+	// 数据较大时与缓冲区一起gather write，避免复制数据
+	std::array<const_buffer, 2> buffers = {
+		buffer(write_buffer_), buffer(data, len)
+	};
+	bool ok = co_await doAsyncWrite(buffers);
+	write_buffer_.clear();
+	co_return ok;
+}
+
+awaitable<bool> Connection::flush()
 {
+	if (write_buffer_.empty())
+		co_return true;
+
+	bool ok = co_await doAsyncWrite(buffer(write_buffer_));
+	write_buffer_.clear();
+	co_return ok;
+}
+
+awaitable<bool> Connection::asyncSendFile(int fd, std::size_t offset, std::size_t length)
+{
+	auto& sock = socket_.lowest_layer();
+	if (ktls_tx_) {
+		// 先发送输出缓冲区中的头部等数据，保证顺序
+		if (!co_await flush())
+			co_return false;
+
+		sock.native_non_blocking(true);
+		off_t off = static_cast<off_t>(offset);
+		std::size_t end = offset + length;
+		while (static_cast<std::size_t>(off) < end) {
+			auto n = ::sendfile(sock.native_handle(), fd, &off, end - off);
+			if (n > 0)
+				continue;
+
+			if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+				// 发送缓冲区已满，等待socket可写
+				enterPhase(Phase::write);
+				error_code ec;
+				co_await sock.async_wait(tcp::socket::wait_write,
+								redirect_error(use_awaitable, ec));
+				if (!ec)
+					continue;
+			} else if (n < 0 && errno == EINTR) {
+				continue;
+			}
+
+			// 文件被截断或socket出错
+			stop();
+			co_return false;
+		}
+		co_return true;
+	}
+
+	// 读取文件或写入socket出错，关闭连接
+	bool ok = co_await readFile(fd, offset, length,
+		[this](const char* data, std::size_t n) { return asyncWrite(data, n); });
+	if (!ok)
+		stop();
+	co_return ok;
+}
+
+awaitable<bool> Connection::readFile(int fd, std::size_t offset, std::size_t length,
+	std::function<awaitable<bool>(const char*, std::size_t)> write)
+{
+#if defined(ASIO_HAS_IO_URING)
+	// 通过io_uring异步读取文件，读磁盘时不阻塞io_context线程
+	// random_access_file关闭时会关闭描述符，因此使用复制的描述符
+	asio::random_access_file file(socket_.get_executor());
+	error_code ec;
+	int file_fd = ::dup(fd);
+	if (file_fd >= 0)
+		file.assign(file_fd, ec);
+	if (file_fd < 0 || ec) {
+		if (file_fd >= 0)
+			::close(file_fd);
+		co_return false;
+	}
+#endif
+
+	auto buf = BufferPool::acquire(BufferPool::large_buffer_size);
+	std::size_t end = offset + length;
+	while (offset < end) {
+#if defined(ASIO_HAS_IO_URING)
+		std::size_t n = co_await file.async_read_some_at(offset,
+						buffer(buf.data(), std::min(buf.size(), end - offset)),
+						redirect_error(use_awaitable, ec));
+		// 文件被截断时返回eof
+		if (ec || n == 0)
+			co_return false;
+#else
+		auto n = ::pread(fd, buf.data(), std::min(buf.size(), end - offset),
+						static_cast<off_t>(offset));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			co_return false;
+#endif
+
+		if (!co_await write(buf.data(), static_cast<std::size_t>(n)))
+			co_return false;
+		offset += static_cast<std::size_t>(n);
+	}
+
+	co_return true;
+}
+
+template <typename ConstBufferSequence>
+awaitable<bool> Connection::doAsyncWrite(const ConstBufferSequence& buffers)
+{
+	// 每次写操作重新计时，客户端停止接收数据时关闭连接
+	enterPhase(Phase::write);
+
 	error_code ec;
-	asio::write(socket_, buffer(data, len), ec);
+	// 启用kTLS后由内核加密，直接写入tcp socket
+	if (ktls_tx_) {
+		co_await asio::async_write(socket_.next_layer(), buffers,
+							redirect_error(use_awaitable, ec));
+	} else {
+		co_await asio::async_write(socket_, buffers,
+							redirect_error(use_awaitable, ec));
+	}
 
 	if (!ec) {
-		return true;
+		co_return true;
 	} else if (ec != asio::error::operation_aborted) {
 		stop();
 	}
 
-	return false;
+	co_return false;
 }
 
 } // namespace https_server
\ No newline at end of file
@@ -3,14 +3,25 @@
 #include "request.hpp"
 #include "response.hpp"
 #include "request_handler.hpp"
+#include "response_writer.hpp"
 #include "request_parser.hpp"
 #include "option.hpp"
+#include "buffer_pool.hpp"
+#include "ktls.hpp"
+#include "timer_wheel.hpp"
+#include "io_context_load.hpp"
+#include "admission_control.hpp"
+#include "session_resumption.hpp"
+#include "connection_manager.hpp"
+#include "http2_session.hpp"
 
 #include <asio.hpp>
 #include <asio/ssl.hpp>
 
 #include <memory>
 #include <array>
+#include <string>
+#include <functional>
 
 
 namespace https_server {
@@ -18,8 +29,14 @@ namespace https_server {
 // 设置套接字别名
 using ssl_socket = asio::ssl::stream<asio::ip::tcp::socket>;
 
-class Connection : public std::enable_shared_from_this<Connection> {
+class Connection : public ResponseWriter,
+                   public std::enable_shared_from_this<Connection> {
 private:
+    // HTTP/2会话直接使用连接的套接字、超时和输出
+    friend class Http2Session;
+    // HTTP/2的流与连接共用读取文件的实现
+    friend class Http2Stream;
+
     // 请求
     Request req_;
 
@@ -32,26 +49,110 @@ private:
     // 处理响应
     RequestHandler& req_handler_;
 
+    // 创建本连接时使用的ssl上下文
+    // 重新加载证书后，已有的连接继续使用原来的上下文，直到连接结束
+    std::shared_ptr<asio::ssl::context> ssl_context_;
+
     // ssl套接字
     ssl_socket socket_;
 
-    std::array<char, 8192> buffer_;
+    // 输出缓冲区，合并小的写操作，减少TLS记录和系统调用的数量
+    std::string write_buffer_;
+
+    // 当前请求的响应头部是否已经写出
+    // 服务抛出异常时据此判断能否改为发送500响应
+    bool head_written_ = false;
+
+    // 握手过程中收集的kTLS密钥信息
+    ktls::HandshakeState ktls_state_;
+
+    // 发送方向是否已由内核加密
+    // 为true时数据以明文直接写入tcp socket
+    bool ktls_tx_ = false;
+
+    // 当前线程共享的时间轮
+    TimerWheel& timer_wheel_;
+
+    // 所在io_context的负载，连接开始后计入存活连接数
+    IoContextLoad& load_;
+
+    // 过载保护，记录连接数、握手数和请求数
+    AdmissionControl& admission_;
 
-    // 设置定时器，超时关闭连接
-    asio::steady_timer timer_;
+    // 所在io_context的连接管理器，握手开始时加入，连接结束时移除
+    ConnectionManager& manager_;
+
+    // 连接的超时期限，到期时关闭连接
+    TimerWheel::Entry deadline_;
+
+    // 连接所处的阶段，每个阶段使用各自的超时时间
+    enum class Phase {
+        handshake,  // TLS握手
+        header,     // 读取请求行和头部
+        body,       // 读取请求体
+        write,      // 处理请求并写响应
+        idle        // 长连接等待下一个请求
+    } phase_ = Phase::handshake;
+
+    // 进入请求体阶段的时间
+    TimerWheel::clock_type::time_point body_start_;
+
+    // 请求体阶段已收到的字节数，按最低速率延长期限
+    std::size_t body_received_ = 0;
 
     // 配置信息
     const Option& opt_;
 
-    // 异步等待定时器到期，并执行相关操作
-    asio::awaitable<void> doDeadline(asio::steady_timer& timer);
+    // 通过ALPN协商使用HTTP/2时的会话，否则为空
+    std::unique_ptr<Http2Session> http2_;
+
+    const char name_value_separator_[2] = {':', ' '};
+
+    const char crlf_[2] = {'\r', '\n'};
+
+    // 设置超时期限，timeout为0时取消期限
+    // 重设期限只修改时间轮中的到期时间，开销很小
+    void setDeadline(TimerWheel::clock_type::duration timeout);
+
+    // 进入新的阶段并设置该阶段的超时期限
+    // 阶段未改变时不重新计时，写阶段除外，每次写操作都重新计时
+    void enterPhase(Phase phase);
+
+    // 连接的协程结束时（包括因异常退出）调用，从时间轮和连接管理器中移除
+    // 连接可能在其它线程中析构，因此不在析构函数中移除
+    void release();
+
+    // 读取数据后根据解析状态切换阶段
+    // 请求体阶段按最低速率延长期限
+    void updateReadPhase(std::size_t bytes_read);
 
     // tls握手
     asio::awaitable<void> doHandshake();
 
     // 异步的读操作
+    // 支持HTTP/1.1流水线，一次读取中的多个请求将按顺序处理，
+    // 它们的响应在全部处理完毕后合并发送
+    // 读缓冲区只在读操作进行时从BufferPool借出，连接空闲时不占用缓冲区
     asio::awaitable<void> doRead();
 
+    // 判断TLS层是否还有已收到但未被读取的数据
+    // 此时不能等待socket可读，而应直接读取
+    // asio的ssl::stream自身缓存的密文无法查询，需由调用方根据上次读取的结果判断
+    bool hasPendingTlsData();
+
+    // 读取文件fd中[offset, offset + length)范围的数据，每读取一块交给write发送
+    // 使用io_uring构建时异步读取，读磁盘时不阻塞io_context线程，否则使用pread
+    // 读取出错、文件被截断或write返回false时返回false
+    asio::awaitable<bool> readFile(int fd, std::size_t offset, std::size_t length,
+        std::function<asio::awaitable<bool>(const char*, std::size_t)> write);
+
+    // 异步写操作的实现，将buffers全部写入socket中
+    template <typename ConstBufferSequence>
+    asio::awaitable<bool> doAsyncWrite(const ConstBufferSequence& buffers);
+
+    // 将状态行和头部信息序列化到out中
+    void serializeHead(const Response& res, std::string& out);
+
     // 重置本次连接
     // 如果客户端需要保持长连接，那么需要在下次读数据时
     // 重置req，res，req_parser等对象
@@ -62,13 +163,18 @@ public:
     Connection(const Connection&) = delete;
     Connection& operator=(const Connection&) = delete;
 
+    // socket: 已建立的tcp连接，属于io_context
+    // 连接数和握手数由调用者在监听线程中计入AdmissionControl，
+    // 握手结束时减去握手数，析构时减去连接数
+    // 需要在io_context的线程中创建和启动
     Connection(asio::io_context& io_context,
-        asio::ssl::context& context,
+        asio::ip::tcp::socket socket,
+        std::shared_ptr<asio::ssl::context> context,
         RequestHandler& handler,
+        AdmissionControl& admission,
         const Option& opt);
     
-    // 测试
-    // ~Connection() { std::cout << "connection close..." << std::endl; }
+    ~Connection();
 
     // 开始本次连接的第一个异步操作
     void start();
@@ -76,10 +182,40 @@ public:
     // 停止本次连接的所有异步操作
     void stop();
 
-    // 将数据写入socket中
-    // 注意：该操作是阻塞的
+    // 服务器即将停止
+    // 正在握手或等待请求的连接立即关闭，正在处理请求的连接发送完响应后关闭
+    // HTTP/2连接发送GOAWAY，所有流的响应发送完毕后关闭
+    // 只能在连接所在的线程中调用
+    void drain();
+
+    // 将状态行和头部信息写入输出缓冲区
+    asio::awaitable<bool> writeHead(const Response& res) override;
+
+    // 异步地将数据写入socket中
+    // 数据先追加到输出缓冲区，缓冲区达到Option::writeBufferSize()时
+    // 才真正写入socket，写操作在当前io_context上挂起，不会阻塞其它连接
     // 当发生错误时返回false, 反之返回true
-    bool doWrite(const char* data, std::size_t len);
+    asio::awaitable<bool> asyncWrite(const char* data, std::size_t len) override;
+
+    // 发送一个分块，格式为: 长度\r\n数据\r\n
+    asio::awaitable<bool> writeChunk(const char* data, std::size_t len) override;
+
+    // 发送最后一个长度为0的分块
+    asio::awaitable<bool> writeLastChunk() override;
+
+    // 将输出缓冲区中的数据全部写入socket中
+    // 当发生错误时返回false, 反之返回true
+    asio::awaitable<bool> flush() override;
+
+    // 将文件fd中[offset, offset + length)范围的数据发送到客户端
+    // 启用kTLS时使用sendfile，数据不经过用户态；
+    // 否则读取文件后通过OpenSSL加密发送，使用io_uring构建时异步读取，否则使用pread
+    // 当发生错误时返回false, 反之返回true
+    asio::awaitable<bool> asyncSendFile(int fd, std::size_t offset, std::size_t length) override;
+
+    // 客户端是否已关闭连接，或连接已被服务器关闭
+    // 不等待、不读取数据，只检查socket上是否已收到FIN或RST
+    bool peerClosed() override;
 
     // 返回当前连接的套接字引用
     ssl_socket::lowest_layer_type& socket();
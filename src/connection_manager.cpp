@@ -0,0 +1,39 @@
+#include "connection_manager.hpp"
+#include "connection.hpp"
+
+#include <vector>
+
+namespace https_server {
+
+asio::execution_context::id ConnectionManager::id;
+
+ConnectionManager::ConnectionManager(asio::io_context& io_context)
+    : asio::execution_context::service(io_context),
+      io_context_(io_context) {}
+
+void ConnectionManager::add(Connection* conn)
+{
+    connections_.insert(conn);
+}
+
+void ConnectionManager::remove(Connection* conn)
+{
+    connections_.erase(conn);
+}
+
+void ConnectionManager::drain()
+{
+    asio::post(io_context_, [this] {
+        // 关闭连接时不会同步地移除，这里仍然复制一份再遍历
+        std::vector<Connection*> connections(connections_.begin(), connections_.end());
+        for (auto conn: connections)
+            conn->drain();
+    });
+}
+
+void ConnectionManager::shutdown()
+{
+    connections_.clear();
+}
+
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <asio.hpp>
+
+#include <unordered_set>
+
+namespace https_server {
+
+class Connection;
+
+// 记录一个io_context上的所有连接，用于停止服务器时关闭空闲的长连接
+// 通过asio::use_service<ConnectionManager>(io_context)获取，
+// 除drain()外只能在该io_context的线程中使用
+class ConnectionManager : public asio::execution_context::service
+{
+public:
+    static asio::execution_context::id id;
+
+    explicit ConnectionManager(asio::io_context& io_context);
+
+    void add(Connection* conn);
+
+    void remove(Connection* conn);
+
+    // 通知所有连接服务器即将停止
+    // 空闲的连接立即关闭，正在处理请求的连接发送完响应后关闭
+    // 可以在任意线程中调用，实际操作在io_context的线程中执行
+    void drain();
+
+private:
+    virtual void shutdown() override;
+
+    asio::io_context& io_context_;
+
+    std::unordered_set<Connection*> connections_;
+};
+
+} // namespace https_server
\ No newline at end of file
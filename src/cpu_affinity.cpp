@@ -0,0 +1,74 @@
+#include "cpu_affinity.hpp"
+
+#include <fstream>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using std::string;
+using std::vector;
+
+namespace https_server {
+namespace cpu_affinity {
+
+bool bindCurrentThread(const vector<int>& cpus)
+{
+    if (cpus.empty())
+        return true;
+
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu: cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    }
+    return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+vector<int> numaNodeCpus(int node)
+{
+    std::ifstream fin("/sys/devices/system/node/node" 
+                + std::to_string(node) + "/cpulist");
+    string list;
+    if (!std::getline(fin, list))
+        return vector<int>();
+    return parseCpuList(list);
+}
+
+vector<int> parseCpuList(const string& list)
+{
+    vector<int> cpus;
+    std::size_t pos = 0;
+    while (pos < list.size()) {
+        auto end = list.find(',', pos);
+        if (end == string::npos)
+            end = list.size();
+
+        auto item = list.substr(pos, end - pos);
+        pos = end + 1;
+
+        try {
+            auto dash = item.find('-');
+            if (dash == string::npos) {
+                cpus.push_back(std::stoi(item));
+            } else {
+                auto first = std::stoi(item.substr(0, dash));
+                auto last = std::stoi(item.substr(dash + 1));
+                for (auto cpu = first; cpu <= last; ++cpu)
+                    cpus.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            // 忽略格式错误的项
+        }
+    }
+    return cpus;
+}
+
+} // namespace cpu_affinity
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace https_server {
+namespace cpu_affinity {
+
+// 将当前线程绑定到cpus中的CPU上，cpus为空时不做任何操作
+// 绑定后线程首次访问的内存（如线程局部的缓冲区池）由内核分配在本地NUMA节点上
+// 成功时返回true
+bool bindCurrentThread(const std::vector<int>& cpus);
+
+// 返回NUMA节点node上的所有CPU，读取失败时返回空数组
+// 可用于将处理连接的线程限制在一个节点上
+std::vector<int> numaNodeCpus(int node);
+
+// 解析形如"0-3,8,10-11"的CPU列表
+std::vector<int> parseCpuList(const std::string& list);
+
+} // namespace cpu_affinity
+} // namespace https_server
\ No newline at end of file
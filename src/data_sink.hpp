@@ -1,5 +1,7 @@
 #pragma once
 
+#include <asio/awaitable.hpp>
+
 #include <functional>
 #include <string>
 
@@ -15,7 +17,25 @@ public:
 
     bool is_writable = true;
 
-    std::function<void(const char* data, std::size_t len)> write;
+    // 异步写入数据，需要使用co_await等待写操作完成
+    // 输出缓冲区已满时挂起，直到数据写入socket，
+    // 供应器生产数据的速度因此受到客户端接收速度的限制
+    // 连接已断开或写入失败时返回false，此时应停止生产数据
+    std::function<asio::awaitable<bool>(const char* data, std::size_t len)> write;
+
+    std::function<asio::awaitable<void>()> done;
+
+    // 立即发送已写入但仍在输出缓冲区中的数据
+    // 适用于需要及时送达客户端的流式数据
+    std::function<asio::awaitable<bool>()> flush;
+
+    // 发送文件fd中[offset, offset + length)范围的数据
+    // 启用kTLS时通过sendfile发送，数据不经过用户态
+    std::function<asio::awaitable<bool>(int fd, std::size_t offset, 
+                                    std::size_t length)> send_file;
 
-    std::function<void()> done;
+    // 客户端是否已断开连接或写入已失败
+    // 供应器在两次写入之间进行耗时操作（如读取磁盘、查询数据库）前应检查，
+    // 返回true时应立即停止
+    std::function<bool()> is_cancelled;
 };
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+namespace https_server {
+
+// 按SNI主机名选择的证书和私钥
+struct HostCertificate
+{
+    // 主机名，如"example.com"，也可以是"*.example.com"形式的通配符，
+    // 通配符只匹配一级子域名
+    std::string host_name;
+
+    // 证书文件路径
+    std::string crt_file_path;
+
+    // 私钥文件路径
+    std::string private_key_file_path;
+
+    // 私钥密码
+    std::string private_key_pwd;
+
+    // 可选的ECDSA证书和私钥文件路径，与上面的证书（通常是RSA）同时使用
+    // 握手时支持ECDSA签名的客户端使用ECDSA证书，其余的客户端使用另一个证书
+    // 私钥密码与上面的相同
+    std::string ecdsa_crt_file_path;
+    std::string ecdsa_private_key_file_path;
+
+    // 可选的DER格式OCSP响应文件，分别对应上面的两个证书，为空时不装订
+    std::string ocsp_response_file_path;
+    std::string ecdsa_ocsp_response_file_path;
+};
+
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,538 @@
+#include "hpack.hpp"
+
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+
+using std::string;
+using std::size_t;
+using std::uint8_t;
+using std::uint32_t;
+using std::uint64_t;
+
+namespace https_server {
+namespace hpack {
+
+namespace {
+
+// 静态表，RFC 7541 附录A，索引从1开始
+const Header static_table[] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+constexpr size_t static_table_size = sizeof(static_table) / sizeof(static_table[0]);
+
+// Huffman编码表，RFC 7541 附录B
+// 每个符号的编码（低位对齐）和位数
+struct HuffmanCode
+{
+    uint32_t code;
+    uint8_t bits;
+};
+
+const HuffmanCode huffman_codes[256] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+    {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+    {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+    {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+    {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+    {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},
+    {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+    {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},
+    {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},
+    {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+    {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+    {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},
+    {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},
+    {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+    {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+    {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},
+    {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},
+    {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+    {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+    {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},
+    {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+    {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+    {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+    {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+    {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},
+    {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},
+    {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+    {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+    {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},
+    {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+    {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+    {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+    {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+    {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+    {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},
+    {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+    {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+    {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+    {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+    {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},
+    {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+    {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+    {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+};
+
+// EOS符号不会出现在合法的编码中，只用于构建解码树
+constexpr HuffmanCode huffman_eos = {0x3fffffff, 30};
+constexpr int huffman_eos_symbol = 256;
+
+// Huffman解码树，内部节点记录两个子节点，叶子节点记录符号
+struct HuffmanNode
+{
+    short children[2] = {-1, -1};
+    short symbol = -1;
+};
+
+const std::vector<HuffmanNode>& huffmanTree()
+{
+    static const std::vector<HuffmanNode> tree = [] {
+        std::vector<HuffmanNode> nodes(1);
+        auto insert = [&](const HuffmanCode& code, int symbol) {
+            size_t node = 0;
+            for (int i = code.bits - 1; i >= 0; --i) {
+                int bit = (code.code >> i) & 1;
+                if (nodes[node].children[bit] < 0) {
+                    nodes[node].children[bit] = static_cast<short>(nodes.size());
+                    nodes.emplace_back();
+                }
+                node = static_cast<size_t>(nodes[node].children[bit]);
+            }
+            nodes[node].symbol = static_cast<short>(symbol);
+        };
+
+        for (int i = 0; i < 256; ++i)
+            insert(huffman_codes[i], i);
+        insert(huffman_eos, huffman_eos_symbol);
+        return nodes;
+    }();
+    return tree;
+}
+
+bool huffmanDecode(const uint8_t* p, size_t len, string& out)
+{
+    const auto& tree = huffmanTree();
+    size_t node = 0;
+
+    // 最后一个符号之后的位数，以及这些位是否全为1
+    // 合法的填充是不超过7位的EOS前缀
+    unsigned pending_bits = 0;
+    bool all_ones = true;
+
+    for (size_t i = 0; i < len; ++i) {
+        for (int shift = 7; shift >= 0; --shift) {
+            int bit = (p[i] >> shift) & 1;
+            auto next = tree[node].children[bit];
+            if (next < 0)
+                return false;
+            node = static_cast<size_t>(next);
+            ++pending_bits;
+            all_ones = all_ones && bit;
+
+            auto symbol = tree[node].symbol;
+            if (symbol >= 0) {
+                if (symbol == huffman_eos_symbol)
+                    return false;
+                out.push_back(static_cast<char>(symbol));
+                node = 0;
+                pending_bits = 0;
+                all_ones = true;
+            }
+        }
+    }
+
+    return pending_bits <= 7 && all_ones;
+}
+
+size_t huffmanEncodedLength(const string& s)
+{
+    size_t bits = 0;
+    for (auto c: s)
+        bits += huffman_codes[static_cast<uint8_t>(c)].bits;
+    return (bits + 7) / 8;
+}
+
+void huffmanEncode(const string& s, string& out)
+{
+    uint64_t acc = 0;
+    unsigned bits = 0;
+    for (auto c: s) {
+        const auto& code = huffman_codes[static_cast<uint8_t>(c)];
+        acc = (acc << code.bits) | code.code;
+        bits += code.bits;
+        while (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>(acc >> bits));
+        }
+        acc &= (uint64_t(1) << bits) - 1;
+    }
+
+    // 使用EOS的前缀填充最后一个字节
+    if (bits > 0)
+        out.push_back(static_cast<char>((acc << (8 - bits)) | (0xff >> bits)));
+}
+
+// 静态表中每个name第一次出现的索引，相同name的条目在静态表中相邻
+const std::unordered_map<std::string_view, size_t>& staticNameIndex()
+{
+    static const std::unordered_map<std::string_view, size_t> index = [] {
+        std::unordered_map<std::string_view, size_t> m;
+        for (size_t i = 0; i < static_table_size; ++i)
+            m.emplace(static_table[i].name, i + 1);
+        return m;
+    }();
+    return index;
+}
+
+// 每个响应都可能不同的字段，加入动态表只会淘汰有用的条目
+bool shouldIndex(const string& name)
+{
+    return name != "content-length" && name != "content-range" &&
+        name != "date" && name != "etag" && name != "last-modified" &&
+        name != "expires" && name != "set-cookie";
+}
+
+size_t entrySize(const string& name, const string& value)
+{
+    return name.size() + value.size() + 32;
+}
+
+} // namespace
+
+DynamicTable::DynamicTable(size_t max_size)
+    : max_size_(max_size) {}
+
+void DynamicTable::add(const string& name, const string& value)
+{
+    auto size = entrySize(name, value);
+    if (size > max_size_) {
+        entries_.clear();
+        size_ = 0;
+        return;
+    }
+
+    entries_.push_front(Header{name, value});
+    size_ += size;
+    evict();
+}
+
+void DynamicTable::setMaxSize(size_t max_size)
+{
+    max_size_ = max_size;
+    evict();
+}
+
+void DynamicTable::evict()
+{
+    while (size_ > max_size_) {
+        const auto& last = entries_.back();
+        size_ -= entrySize(last.name, last.value);
+        entries_.pop_back();
+    }
+}
+
+Decoder::Decoder(size_t max_table_size, size_t max_header_list_size)
+    : table_(max_table_size),
+      max_table_size_(max_table_size),
+      max_header_list_size_(max_header_list_size) {}
+
+const Header* Decoder::lookup(size_t index) const
+{
+    if (index == 0)
+        return nullptr;
+    if (index <= static_table_size)
+        return &static_table[index - 1];
+    index -= static_table_size + 1;
+    if (index < table_.count())
+        return &table_.at(index);
+    return nullptr;
+}
+
+bool Decoder::decodeInteger(const uint8_t*& p, const uint8_t* end,
+                    unsigned prefix, size_t& value)
+{
+    if (p == end)
+        return false;
+
+    size_t max_prefix = (size_t(1) << prefix) - 1;
+    value = *p++ & max_prefix;
+    if (value < max_prefix)
+        return true;
+
+    // 头部块中的整数不会超过2^28，更大的值视为错误，避免溢出
+    for (unsigned shift = 0; ; shift += 7) {
+        if (p == end || shift > 21)
+            return false;
+        uint8_t b = *p++;
+        value += static_cast<size_t>(b & 0x7f) << shift;
+        if ((b & 0x80) == 0)
+            return true;
+    }
+}
+
+bool Decoder::decodeString(const uint8_t*& p, const uint8_t* end, string& out)
+{
+    if (p == end)
+        return false;
+
+    bool huffman = (*p & 0x80) != 0;
+    size_t len = 0;
+    if (!decodeInteger(p, end, 7, len) || len > static_cast<size_t>(end - p))
+        return false;
+
+    out.clear();
+    bool ok = true;
+    if (huffman)
+        ok = huffmanDecode(p, len, out);
+    else
+        out.assign(reinterpret_cast<const char*>(p), len);
+    p += len;
+    return ok;
+}
+
+bool Decoder::decode(const uint8_t* data, size_t len, std::vector<Header>& headers)
+{
+    const uint8_t* p = data;
+    const uint8_t* end = data + len;
+    size_t list_size = 0;
+    bool header_seen = false;
+
+    while (p != end) {
+        uint8_t b = *p;
+        Header header;
+
+        if (b & 0x80) {
+            // 索引字段
+            size_t index = 0;
+            if (!decodeInteger(p, end, 7, index))
+                return false;
+            auto entry = lookup(index);
+            if (!entry)
+                return false;
+            header = *entry;
+        } else if ((b & 0xe0) == 0x20) {
+            // 动态表大小更新，只能出现在头部块的开头
+            size_t size = 0;
+            if (header_seen || !decodeInteger(p, end, 5, size) || size > max_table_size_)
+                return false;
+            table_.setMaxSize(size);
+            continue;
+        } else {
+            // 字面字段，01为加入动态表，0000为不加入，0001为永不加入
+            bool indexing = (b & 0xc0) == 0x40;
+            size_t index = 0;
+            if (!decodeInteger(p, end, indexing ? 6 : 4, index))
+                return false;
+            if (index != 0) {
+                auto entry = lookup(index);
+                if (!entry)
+                    return false;
+                header.name = entry->name;
+            } else if (!decodeString(p, end, header.name)) {
+                return false;
+            }
+            if (!decodeString(p, end, header.value))
+                return false;
+            if (indexing)
+                table_.add(header.name, header.value);
+        }
+
+        header_seen = true;
+        list_size += entrySize(header.name, header.value);
+        if (list_size > max_header_list_size_)
+            return false;
+        headers.push_back(std::move(header));
+    }
+
+    return true;
+}
+
+Encoder::Encoder()
+    : table_(4096) {}
+
+void Encoder::setMaxTableSize(size_t size)
+{
+    // 对端允许更大的动态表时仍然使用默认大小，限制每个连接占用的内存
+    size = std::min<size_t>(size, 4096);
+    if (size == table_.maxSize())
+        return;
+    table_.setMaxSize(size);
+    pending_size_update_ = size;
+}
+
+void Encoder::find(const Header& header, size_t& index, size_t& name_index) const
+{
+    index = 0;
+    name_index = 0;
+
+    const auto& names = staticNameIndex();
+    auto it = names.find(header.name);
+    if (it != names.end()) {
+        name_index = it->second;
+        for (auto i = it->second; i <= static_table_size &&
+                static_table[i - 1].name == header.name; ++i) {
+            if (static_table[i - 1].value == header.value) {
+                index = i;
+                return;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < table_.count(); ++i) {
+        const auto& entry = table_.at(i);
+        if (entry.name != header.name)
+            continue;
+        if (entry.value == header.value) {
+            index = static_table_size + 1 + i;
+            return;
+        }
+        if (name_index == 0)
+            name_index = static_table_size + 1 + i;
+    }
+}
+
+void Encoder::encode(const std::vector<Header>& headers, string& out)
+{
+    if (pending_size_update_ != static_cast<size_t>(-1)) {
+        encodeInteger(pending_size_update_, 5, 0x20, out);
+        pending_size_update_ = static_cast<size_t>(-1);
+    }
+
+    for (const auto& header: headers) {
+        size_t index = 0;
+        size_t name_index = 0;
+        find(header, index, name_index);
+        if (index != 0) {
+            encodeInteger(index, 7, 0x80, out);
+            continue;
+        }
+
+        bool indexing = shouldIndex(header.name);
+        if (indexing)
+            encodeInteger(name_index, 6, 0x40, out);
+        else
+            encodeInteger(name_index, 4, 0x00, out);
+        if (name_index == 0)
+            encodeString(header.name, out);
+        encodeString(header.value, out);
+
+        if (indexing)
+            table_.add(header.name, header.value);
+    }
+}
+
+void encodeInteger(size_t value, unsigned prefix, uint8_t flags, string& out)
+{
+    size_t max_prefix = (size_t(1) << prefix) - 1;
+    if (value < max_prefix) {
+        out.push_back(static_cast<char>(flags | value));
+        return;
+    }
+
+    out.push_back(static_cast<char>(flags | max_prefix));
+    value -= max_prefix;
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void encodeString(const string& s, string& out)
+{
+    auto huffman_len = huffmanEncodedLength(s);
+    if (huffman_len < s.size()) {
+        encodeInteger(huffman_len, 7, 0x80, out);
+        huffmanEncode(s, out);
+    } else {
+        encodeInteger(s.size(), 7, 0x00, out);
+        out += s;
+    }
+}
+
+} // namespace hpack
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "header.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace https_server {
+namespace hpack {
+
+// HTTP/2的头部压缩（RFC 7541）
+// 每个连接的两个方向各有一张动态表，编码器和解码器分别维护，不能跨连接共享
+
+// 动态表，最新加入的条目位于最前面
+class DynamicTable
+{
+public:
+    explicit DynamicTable(std::size_t max_size);
+
+    // 加入一个条目，必要时淘汰最旧的条目
+    // 条目本身大于上限时清空动态表
+    void add(const std::string& name, const std::string& value);
+
+    // 调整上限并淘汰超出的条目
+    void setMaxSize(std::size_t max_size);
+
+    std::size_t maxSize() const { return max_size_; }
+
+    std::size_t count() const { return entries_.size(); }
+
+    // index从0开始，0为最新的条目
+    const Header& at(std::size_t index) const { return entries_[index]; }
+
+private:
+    void evict();
+
+    std::deque<Header> entries_;
+
+    // 条目大小之和，每个条目为name和value的长度加32
+    std::size_t size_ = 0;
+
+    std::size_t max_size_;
+};
+
+// 头部块解码器
+class Decoder
+{
+public:
+    // max_table_size: 通过SETTINGS_HEADER_TABLE_SIZE通告的动态表上限
+    // max_header_list_size: 解码后头部列表的上限，按RFC 7541的条目大小计算
+    Decoder(std::size_t max_table_size, std::size_t max_header_list_size);
+
+    // 解码一个完整的头部块并追加到headers中
+    // 格式错误或超出max_header_list_size时返回false，
+    // 此时动态表可能已与对端不一致，连接必须以COMPRESSION_ERROR关闭
+    bool decode(const std::uint8_t* data, std::size_t len, std::vector<Header>& headers);
+
+private:
+    // 解码prefix位前缀的整数
+    bool decodeInteger(const std::uint8_t*& p, const std::uint8_t* end,
+                    unsigned prefix, std::size_t& value);
+
+    // 解码字符串，可能经过Huffman编码
+    bool decodeString(const std::uint8_t*& p, const std::uint8_t* end, std::string& out);
+
+    // 按索引查找静态表或动态表，index从1开始
+    const Header* lookup(std::size_t index) const;
+
+    DynamicTable table_;
+
+    // 对端可以使用的动态表上限
+    std::size_t max_table_size_;
+
+    std::size_t max_header_list_size_;
+};
+
+// 头部块编码器
+class Encoder
+{
+public:
+    Encoder();
+
+    // 对端通过SETTINGS_HEADER_TABLE_SIZE调整了动态表上限
+    // 下一个头部块的开头将通知对端新的大小
+    void setMaxTableSize(std::size_t size);
+
+    // 将headers编码为一个头部块追加到out中，name必须为小写
+    // 完全匹配的字段使用索引，其它字段加入动态表，
+    // 每个响应都不同的字段（如content-length）不加入动态表，避免淘汰有用的条目
+    void encode(const std::vector<Header>& headers, std::string& out);
+
+private:
+    // 查找完全匹配的字段和只有name匹配的字段，找不到时为0
+    void find(const Header& header, std::size_t& index, std::size_t& name_index) const;
+
+    DynamicTable table_;
+
+    // 需要在下一个头部块开头通知对端的动态表大小，-1表示不需要
+    std::size_t pending_size_update_ = static_cast<std::size_t>(-1);
+};
+
+// 编码prefix位前缀的整数，flags为第一个字节中前缀之外的高位
+void encodeInteger(std::size_t value, unsigned prefix, std::uint8_t flags, std::string& out);
+
+// 编码字符串，Huffman编码更短时使用Huffman编码
+void encodeString(const std::string& s, std::string& out);
+
+} // namespace hpack
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,1045 @@
+#include "http2_session.hpp"
+#include "connection.hpp"
+#include "buffer_pool.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string_view>
+
+using std::string;
+using std::string_view;
+using std::size_t;
+using std::uint8_t;
+using std::uint32_t;
+using std::int64_t;
+using std::shared_ptr;
+using std::error_code;
+using asio::awaitable;
+using asio::co_spawn;
+using asio::detached;
+using asio::use_awaitable;
+using asio::redirect_error;
+
+namespace https_server {
+
+namespace {
+
+// 客户端连接前言
+constexpr string_view client_preface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+constexpr size_t frame_header_size = 9;
+
+// 本端接收的最大帧，使用协议的默认值
+constexpr size_t max_frame_size = 16384;
+
+// 每个流和整个连接的接收窗口
+// 请求体直接追加到Request::body，因此收到数据后即可归还窗口
+constexpr int64_t receive_window = 1 << 20;
+
+// 解码后的请求头部上限，同时限制未解码的头部块
+constexpr size_t max_header_list_size = 65536;
+
+// 输出缓冲区达到该大小时，发送数据的流挂起直到缓冲区被写出
+constexpr size_t output_buffer_limit = 65536;
+
+constexpr int64_t max_window = 0x7fffffff;
+
+enum SettingId : uint32_t {
+    settings_header_table_size = 0x1,
+    settings_enable_push = 0x2,
+    settings_max_concurrent_streams = 0x3,
+    settings_initial_window_size = 0x4,
+    settings_max_frame_size = 0x5,
+    settings_max_header_list_size = 0x6
+};
+
+uint32_t readUint32(const uint8_t* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+        (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+void appendUint32(string& out, uint32_t value)
+{
+    out.push_back(static_cast<char>(value >> 24));
+    out.push_back(static_cast<char>(value >> 16));
+    out.push_back(static_cast<char>(value >> 8));
+    out.push_back(static_cast<char>(value));
+}
+
+// HTTP/2中不允许出现的连接相关头部
+bool isConnectionHeader(const string& name)
+{
+    return name == "connection" || name == "keep-alive" ||
+        name == "proxy-connection" || name == "transfer-encoding" ||
+        name == "upgrade";
+}
+
+int selectAlpn(SSL* /*ssl*/, const unsigned char** out, unsigned char* outlen,
+            const unsigned char* in, unsigned int inlen, void* /*arg*/)
+{
+    static const unsigned char protocols[] = "\x02h2\x08http/1.1";
+    unsigned char* selected = nullptr;
+    if (::SSL_select_next_proto(&selected, outlen, protocols, sizeof(protocols) - 1,
+                                in, inlen) != OPENSSL_NPN_NEGOTIATED)
+        return SSL_TLSEXT_ERR_NOACK;
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+} // namespace
+
+Http2Stream::Http2Stream(Http2Session& session, uint32_t id, int64_t send_window)
+    : session_(session),
+      id_(id),
+      send_window_(send_window),
+      recv_window_(receive_window) {}
+
+awaitable<bool> Http2Stream::writeHead(const Response& res)
+{
+    head_.clear();
+    head_.push_back(Header{":status", std::to_string(static_cast<int>(res.status))});
+    for (const auto& h: res.headers) {
+        Header header{h.name, h.value};
+        std::transform(header.name.begin(), header.name.end(), header.name.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (!isConnectionHeader(header.name))
+            head_.push_back(std::move(header));
+    }
+    head_pending_ = true;
+    co_return !peerClosed();
+}
+
+awaitable<bool> Http2Stream::asyncWrite(const char* data, size_t len)
+{
+    if (peerClosed())
+        co_return false;
+
+    // 较大的数据直接分帧发送，不复制到流的缓冲区
+    if (data_.empty() && len >= session_.peer_max_frame_size_)
+        co_return co_await sendData(data, len, false);
+
+    data_.append(data, len);
+    if (data_.size() < session_.peer_max_frame_size_)
+        co_return true;
+
+    bool ok = co_await sendData(data_.data(), data_.size(), false);
+    data_.clear();
+    co_return ok;
+}
+
+awaitable<bool> Http2Stream::writeChunk(const char* data, size_t len)
+{
+    co_return co_await asyncWrite(data, len);
+}
+
+awaitable<bool> Http2Stream::writeLastChunk()
+{
+    co_return !peerClosed();
+}
+
+awaitable<bool> Http2Stream::flush()
+{
+    if (peerClosed())
+        co_return false;
+
+    sendHead(false);
+    if (data_.empty())
+        co_return true;
+
+    bool ok = co_await sendData(data_.data(), data_.size(), false);
+    data_.clear();
+    co_return ok;
+}
+
+awaitable<bool> Http2Stream::asyncSendFile(int fd, size_t offset, size_t length)
+{
+    // 与HTTP/1.1共用读取文件的实现，io_uring构建时不阻塞io_context线程
+    co_return co_await session_.conn_.readFile(fd, offset, length,
+        [this](const char* data, size_t n) { return asyncWrite(data, n); });
+}
+
+bool Http2Stream::peerClosed()
+{
+    return reset_ || session_.closed_;
+}
+
+awaitable<bool> Http2Stream::finish()
+{
+    if (peerClosed() || local_closed_)
+        co_return false;
+
+    if (head_pending_ && data_.empty()) {
+        sendHead(true);
+        co_return true;
+    }
+
+    bool ok = co_await sendData(data_.data(), data_.size(), true);
+    data_.clear();
+    co_return ok;
+}
+
+void Http2Stream::sendHead(bool end_stream)
+{
+    if (!head_pending_)
+        return;
+
+    session_.writeHeaders(id_, head_, end_stream);
+    head_pending_ = false;
+    head_.clear();
+    if (end_stream)
+        local_closed_ = true;
+}
+
+awaitable<bool> Http2Stream::sendData(const char* data, size_t len, bool end_stream)
+{
+    if (len == 0 && !end_stream)
+        co_return true;
+
+    sendHead(false);
+
+    do {
+        if (peerClosed())
+            co_return false;
+
+        // 输出缓冲区已满，等待写协程写出
+        if (session_.out_.size() >= output_buffer_limit) {
+            co_await Http2Session::wait(session_.changed_);
+            continue;
+        }
+
+        int64_t window = std::min(send_window_, session_.send_window_);
+        size_t n = std::min(len, session_.peer_max_frame_size_);
+        n = std::min(n, static_cast<size_t>(std::max<int64_t>(window, 0)));
+
+        // 窗口已耗尽，等待对端的WINDOW_UPDATE
+        if (len > 0 && n == 0) {
+            co_await Http2Session::wait(session_.changed_);
+            continue;
+        }
+
+        bool last = end_stream && n == len;
+        session_.writeFrameHeader(n, Http2Session::data_frame,
+                        last ? Http2Session::end_stream_flag : 0, id_);
+        session_.out_.append(data, n);
+        send_window_ -= static_cast<int64_t>(n);
+        session_.send_window_ -= static_cast<int64_t>(n);
+        data += n;
+        len -= n;
+        if (last)
+            local_closed_ = true;
+    } while (len > 0);
+
+    co_return true;
+}
+
+Http2Session::Http2Session(Connection& conn)
+    : conn_(conn),
+      opt_(conn.opt_),
+      req_parser_(conn.opt_),
+      decoder_(4096, max_header_list_size),
+      out_ready_(conn.socket_.get_executor(), asio::steady_timer::time_point::max()),
+      changed_(conn.socket_.get_executor(), asio::steady_timer::time_point::max()) {}
+
+void Http2Session::setupContext(SSL_CTX* ctx)
+{
+    ::SSL_CTX_set_alpn_select_cb(ctx, selectAlpn, nullptr);
+}
+
+bool Http2Session::negotiated(SSL* ssl)
+{
+    const unsigned char* protocol = nullptr;
+    unsigned int len = 0;
+    ::SSL_get0_alpn_selected(ssl, &protocol, &len);
+    return len == 2 && std::memcmp(protocol, "h2", 2) == 0;
+}
+
+void Http2Session::notify(asio::steady_timer& signal)
+{
+    signal.cancel();
+}
+
+awaitable<void> Http2Session::wait(asio::steady_timer& signal)
+{
+    error_code ec;
+    co_await signal.async_wait(redirect_error(use_awaitable, ec));
+}
+
+awaitable<void> Http2Session::run()
+{
+    auto self = conn_.shared_from_this();
+
+    error_code ec;
+    remote_addr_ = conn_.socket_.lowest_layer().remote_endpoint(ec).address().to_string();
+
+    // 服务端的SETTINGS必须是连接上的第一个帧
+    // 同时将连接的接收窗口扩大到与流相同
+    writeSettings();
+    writeWindowUpdate(0, static_cast<size_t>(receive_window - recv_window_));
+    recv_window_ = receive_window;
+
+    co_spawn(conn_.socket_.get_executor(),
+        [self, this] { return doWrite(); }, detached);
+
+    auto& sock = conn_.socket_;
+    bool protocol_error = false;
+    bool buffer_filled = false;
+    while (!closed_) {
+        // 连接空闲时只等待socket可读，不持有读缓冲区
+        // 上次读取填满了缓冲区时asio内部可能仍有缓存的数据，直接读取
+        if (!buffer_filled && !conn_.hasPendingTlsData()) {
+            co_await sock.lowest_layer().async_wait(asio::ip::tcp::socket::wait_read,
+                                    redirect_error(use_awaitable, ec));
+            if (ec)
+                break;
+        }
+
+        // 正在接收请求体时借出大缓冲区
+        bool receiving = streams_.size() > processing_;
+        auto buf = BufferPool::acquire(receiving ? BufferPool::large_buffer_size : 0);
+        std::size_t n = co_await sock.async_read_some(asio::buffer(buf.data(), buf.size()),
+                                    redirect_error(use_awaitable, ec));
+        if (ec)
+            break;
+        buffer_filled = n == buf.size();
+
+        if (!consume(buf.data(), n)) {
+            protocol_error = true;
+            break;
+        }
+        updatePhase();
+    }
+
+    // 读取出错或对端关闭了连接，之后的写操作都将失败
+    // 发生协议错误时由写协程发送完GOAWAY后关闭连接
+    if (!protocol_error) {
+        closed_ = true;
+        conn_.stop();
+    }
+    notify(out_ready_);
+    notify(changed_);
+
+    // 等待写协程和所有处理请求的协程结束
+    while (!writer_done_ || processing_ > 0)
+        co_await wait(changed_);
+}
+
+void Http2Session::drain()
+{
+    if (!goaway_sent_)
+        writeGoaway(no_error);
+    closing_ = true;
+    notify(out_ready_);
+}
+
+awaitable<void> Http2Session::doWrite()
+{
+    string sending;
+    while (!closed_) {
+        if (out_.empty()) {
+            if (closing_ && streams_.empty())
+                break;
+
+            // 连接空闲时释放输出缓冲区占用的内存
+            if (streams_.empty())
+                string().swap(sending);
+
+            co_await wait(out_ready_);
+            continue;
+        }
+
+        sending.swap(out_);
+        bool ok = co_await conn_.asyncWrite(sending.data(), sending.size()) &&
+            co_await conn_.flush();
+        sending.clear();
+        notify(changed_);
+        if (!ok)
+            break;
+
+        if (streams_.empty())
+            std::string().swap(conn_.write_buffer_);
+    }
+
+    closed_ = true;
+    conn_.stop();
+    writer_done_ = true;
+    notify(changed_);
+}
+
+awaitable<void> Http2Session::doStream(shared_ptr<Http2Stream> stream, bool parsed)
+{
+    auto& handler = conn_.req_handler_;
+    if (parsed)
+        co_await handler.handleRequest(*stream, stream->req_, stream->res_);
+    else
+        co_await handler.writeStockResponseWithStatus(*stream, stream->res_.status);
+    co_await stream->finish();
+}
+
+void Http2Session::dispatch(const shared_ptr<Http2Stream>& stream, bool parsed)
+{
+    stream->dispatched_ = true;
+
+    // 正在处理的请求过多，拒绝本流，客户端可以安全地重试
+    bool admitted = false;
+    if (parsed) {
+        if (!conn_.admission_.tryAddRequest(conn_.load_)) {
+            resetStream(stream->id_, refused_stream);
+            streams_.erase(stream->id_);
+            return;
+        }
+        admitted = true;
+    }
+
+    ++processing_;
+    updatePhase();
+    co_spawn(conn_.socket_.get_executor(), doStream(stream, parsed),
+        [self = conn_.shared_from_this(), this, stream, admitted](std::exception_ptr) {
+            if (admitted)
+                conn_.admission_.removeRequest(conn_.load_);
+
+            if (!stream->reset_ && !closed_) {
+                if (!stream->local_closed_) {
+                    // 处理请求时发生异常，响应不完整
+                    resetStream(stream->id_, internal_error);
+                } else if (!stream->remote_closed_) {
+                    // 响应已经完整，不再需要请求剩余的数据
+                    resetStream(stream->id_, no_error);
+                }
+            }
+
+            streams_.erase(stream->id_);
+            --processing_;
+            updatePhase();
+            notify(out_ready_);
+            notify(changed_);
+        });
+}
+
+void Http2Session::updatePhase()
+{
+    if (closed_)
+        return;
+
+    if (processing_ > 0) {
+        conn_.enterPhase(Connection::Phase::write);
+    } else if (streams_.size() > 0 || header_stream_id_ != 0 || last_stream_id_ == 0) {
+        // 第一个请求到达之前以及接收请求期间使用头部超时
+        conn_.enterPhase(Connection::Phase::header);
+    } else {
+        conn_.enterPhase(Connection::Phase::idle);
+    }
+}
+
+bool Http2Session::consume(const char* data, size_t len)
+{
+    // 上次剩余的不完整帧与本次的数据拼接后处理
+    bool buffered = !in_.empty();
+    if (buffered)
+        in_.append(data, len);
+    string_view input = buffered ? string_view(in_) : string_view(data, len);
+    size_t pos = 0;
+    bool ok = true;
+
+    if (!preface_received_) {
+        auto n = std::min(input.size(), client_preface.size());
+        if (input.substr(0, n) != client_preface.substr(0, n))
+            return connectionError(protocol_error);
+        if (n == client_preface.size()) {
+            preface_received_ = true;
+            pos = n;
+        }
+    }
+
+    while (preface_received_ && input.size() - pos >= frame_header_size) {
+        auto p = reinterpret_cast<const uint8_t*>(input.data() + pos);
+        size_t length = (size_t(p[0]) << 16) | (size_t(p[1]) << 8) | p[2];
+        if (length > max_frame_size) {
+            ok = connectionError(frame_size_error);
+            break;
+        }
+        if (input.size() - pos < frame_header_size + length)
+            break;
+
+        ok = processFrame(p[3], p[4], readUint32(p + 5) & 0x7fffffff,
+                        p + frame_header_size, length);
+        pos += frame_header_size + length;
+        if (!ok)
+            break;
+    }
+
+    if (!ok) {
+        in_.clear();
+        return false;
+    }
+
+    if (buffered)
+        in_.erase(0, pos);
+    else
+        in_.assign(input.substr(pos));
+    return true;
+}
+
+bool Http2Session::processFrame(uint8_t type, uint8_t flags, uint32_t stream_id,
+                    const uint8_t* payload, size_t len)
+{
+    // 第一个帧必须是SETTINGS
+    if (!settings_received_ && (type != settings_frame || (flags & ack_flag)))
+        return connectionError(protocol_error);
+
+    // 头部块必须连续，期间不能出现其它帧
+    if (header_stream_id_ != 0 &&
+        (type != continuation_frame || stream_id != header_stream_id_))
+        return connectionError(protocol_error);
+
+    switch (type) {
+    case data_frame:
+        return onData(flags, stream_id, payload, len);
+    case headers_frame:
+        return onHeaders(flags, stream_id, payload, len);
+    case continuation_frame:
+        if (header_stream_id_ == 0)
+            return connectionError(protocol_error);
+        return onContinuation(flags, payload, len);
+    case priority_frame:
+        // 不支持优先级，只检查格式
+        if (stream_id == 0)
+            return connectionError(protocol_error);
+        if (len != 5)
+            resetStream(stream_id, frame_size_error);
+        return true;
+    case rst_stream_frame:
+        return onRstStream(stream_id, payload, len);
+    case settings_frame:
+        return onSettings(flags, stream_id, payload, len);
+    case push_promise_frame:
+        // 客户端不能推送
+        return connectionError(protocol_error);
+    case ping_frame:
+        if (stream_id != 0)
+            return connectionError(protocol_error);
+        if (len != 8)
+            return connectionError(frame_size_error);
+        if (!(flags & ack_flag)) {
+            writeFrameHeader(8, ping_frame, ack_flag, 0);
+            out_.append(reinterpret_cast<const char*>(payload), len);
+        }
+        return true;
+    case goaway_frame:
+        if (stream_id != 0)
+            return connectionError(protocol_error);
+        if (len < 8)
+            return connectionError(frame_size_error);
+        // 对端不会再创建新的流，已有的流处理完毕后关闭连接
+        closing_ = true;
+        notify(out_ready_);
+        return true;
+    case window_update_frame:
+        return onWindowUpdate(stream_id, payload, len);
+    default:
+        // 忽略未知类型的帧
+        return true;
+    }
+}
+
+bool Http2Session::onData(uint8_t flags, uint32_t stream_id,
+                    const uint8_t* payload, size_t len)
+{
+    if (stream_id == 0)
+        return connectionError(protocol_error);
+
+    // 填充同样计入流量控制
+    recv_window_ -= static_cast<int64_t>(len);
+    if (recv_window_ < 0)
+        return connectionError(flow_control_error);
+
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end() || it->second->remote_closed_) {
+        if (stream_id > last_stream_id_)
+            return connectionError(protocol_error);
+        consumeWindow(nullptr, len);
+        resetStream(stream_id, stream_closed);
+        return true;
+    }
+
+    auto stream = it->second;
+    stream->recv_window_ -= static_cast<int64_t>(len);
+    if (stream->recv_window_ < 0) {
+        consumeWindow(nullptr, len);
+        resetStream(stream_id, flow_control_error);
+        return true;
+    }
+
+    // 归还窗口时按包含填充的整个帧长度计算，否则填充占用的窗口永远不会归还
+    auto frame_len = len;
+    if (flags & padded_flag) {
+        if (len < 1 || payload[0] >= len)
+            return connectionError(protocol_error);
+        len -= 1 + payload[0];
+        payload += 1;
+    }
+
+    bool end_stream = flags & end_stream_flag;
+    consumeWindow(end_stream ? nullptr : stream.get(), frame_len);
+
+    if (end_stream)
+        stream->remote_closed_ = true;
+
+    // 已经开始响应的流（如请求体过大）丢弃剩余的数据
+    if (stream->dispatched_)
+        return true;
+
+    auto& body = stream->req_.body;
+    if (stream->content_length_ >= 0 &&
+        body.size() + len > static_cast<size_t>(stream->content_length_)) {
+        resetStream(stream_id, protocol_error);
+        return true;
+    }
+
+    if (body.size() + len > opt_.requestMaxLength()) {
+        stream->res_.status = StatusCode::payload_too_large;
+        dispatch(stream, false);
+        return true;
+    }
+
+    body.append(reinterpret_cast<const char*>(payload), len);
+    if (end_stream)
+        endRequest(stream);
+    return true;
+}
+
+void Http2Session::consumeWindow(Http2Stream* stream, size_t len)
+{
+    // 请求体已经复制到Request中，累计达到窗口的一半时一次性归还
+    recv_unacked_ += len;
+    if (recv_unacked_ >= static_cast<size_t>(receive_window / 2)) {
+        writeWindowUpdate(0, recv_unacked_);
+        recv_window_ += static_cast<int64_t>(recv_unacked_);
+        recv_unacked_ = 0;
+    }
+
+    if (!stream)
+        return;
+    stream->recv_unacked_ += len;
+    if (stream->recv_unacked_ >= static_cast<size_t>(receive_window / 2)) {
+        writeWindowUpdate(stream->id_, stream->recv_unacked_);
+        stream->recv_window_ += static_cast<int64_t>(stream->recv_unacked_);
+        stream->recv_unacked_ = 0;
+    }
+}
+
+bool Http2Session::onHeaders(uint8_t flags, uint32_t stream_id,
+                    const uint8_t* payload, size_t len)
+{
+    if (stream_id == 0)
+        return connectionError(protocol_error);
+
+    if (flags & padded_flag) {
+        if (len < 1 || payload[0] >= len)
+            return connectionError(protocol_error);
+        len -= 1 + payload[0];
+        payload += 1;
+    }
+
+    // 不支持优先级，跳过依赖的流和权重
+    if (flags & priority_flag) {
+        if (len < 5)
+            return connectionError(frame_size_error);
+        payload += 5;
+        len -= 5;
+    }
+
+    header_stream_id_ = stream_id;
+    header_flags_ = flags;
+    header_block_.assign(reinterpret_cast<const char*>(payload), len);
+
+    if (flags & end_headers_flag)
+        return onHeaderBlock();
+    return true;
+}
+
+bool Http2Session::onContinuation(uint8_t flags, const uint8_t* payload, size_t len)
+{
+    if (header_block_.size() + len > max_header_list_size)
+        return connectionError(enhance_your_calm);
+
+    header_block_.append(reinterpret_cast<const char*>(payload), len);
+    if (flags & end_headers_flag)
+        return onHeaderBlock();
+    return true;
+}
+
+bool Http2Session::onHeaderBlock()
+{
+    auto stream_id = header_stream_id_;
+    bool end_stream = header_flags_ & end_stream_flag;
+    header_stream_id_ = 0;
+
+    // 无论流是否被接受都必须解码，保持动态表与对端一致
+    std::vector<Header> headers;
+    if (!decoder_.decode(reinterpret_cast<const uint8_t*>(header_block_.data()),
+                        header_block_.size(), headers))
+        return connectionError(compression_error);
+    header_block_.clear();
+
+    auto it = streams_.find(stream_id);
+    if (it != streams_.end()) {
+        // 请求体之后的trailer，必须结束流，内容被忽略
+        auto stream = it->second;
+        if (stream->remote_closed_) {
+            resetStream(stream_id, stream_closed);
+        } else if (!end_stream) {
+            resetStream(stream_id, protocol_error);
+        } else {
+            stream->remote_closed_ = true;
+            if (!stream->dispatched_)
+                endRequest(stream);
+        }
+        return true;
+    }
+
+    // 客户端创建的流ID必须为奇数
+    if (stream_id % 2 == 0)
+        return connectionError(protocol_error);
+
+    // 已关闭的流上迟到的头部块，如流被重置或响应提前完成时对端已发出的trailer
+    // 头部块已经解码，动态表保持一致，只作为该流的错误处理，不影响其它流
+    if (stream_id <= last_stream_id_) {
+        resetStream(stream_id, stream_closed);
+        return true;
+    }
+    last_stream_id_ = stream_id;
+
+    // 已发送GOAWAY，忽略新的流
+    if (goaway_sent_)
+        return true;
+
+    if (streams_.size() >= opt_.http2MaxConcurrentStreams()) {
+        resetStream(stream_id, refused_stream);
+        return true;
+    }
+
+    auto stream = std::make_shared<Http2Stream>(*this, stream_id, peer_initial_window_);
+    if (!parseHeaders(headers, *stream)) {
+        resetStream(stream_id, protocol_error);
+        return true;
+    }
+    streams_.emplace(stream_id, stream);
+
+    if (stream->content_length_ > static_cast<int64_t>(opt_.requestMaxLength())) {
+        stream->res_.status = StatusCode::payload_too_large;
+        stream->remote_closed_ = end_stream;
+        dispatch(stream, false);
+        return true;
+    }
+
+    if (end_stream) {
+        stream->remote_closed_ = true;
+        endRequest(stream);
+    }
+    return true;
+}
+
+bool Http2Session::parseHeaders(std::vector<Header>& headers, Http2Stream& stream)
+{
+    auto& req = stream.req_;
+    string scheme;
+    string authority;
+    string cookie;
+    bool regular_seen = false;
+
+    for (auto& h: headers) {
+        if (h.name.empty())
+            return false;
+
+        if (h.name[0] == ':') {
+            // 伪头部必须位于普通头部之前，且不能重复
+            if (regular_seen)
+                return false;
+            string* field = nullptr;
+            if (h.name == ":method")
+                field = &req.method;
+            else if (h.name == ":path")
+                field = &req.uri;
+            else if (h.name == ":scheme")
+                field = &scheme;
+            else if (h.name == ":authority")
+                field = &authority;
+            if (!field || !field->empty() || h.value.empty())
+                return false;
+            *field = std::move(h.value);
+            continue;
+        }
+
+        regular_seen = true;
+        if (std::any_of(h.name.begin(), h.name.end(),
+                [](unsigned char c) { return std::isupper(c); }))
+            return false;
+        if (isConnectionHeader(h.name) || (h.name == "te" && h.value != "trailers"))
+            return false;
+
+        // 多个cookie字段合并为一个
+        if (h.name == "cookie") {
+            if (!cookie.empty())
+                cookie += "; ";
+            cookie += h.value;
+            continue;
+        }
+
+        if (h.name == "content-length") {
+            if (h.value.empty() || h.value.size() > 18 ||
+                !std::all_of(h.value.begin(), h.value.end(),
+                    [](unsigned char c) { return std::isdigit(c); }))
+                return false;
+            stream.content_length_ = std::stoll(h.value);
+        }
+
+        req.headers.push_back(std::move(h));
+    }
+
+    if (req.method.empty() || req.uri.empty() || scheme.empty())
+        return false;
+
+    // 服务可能依赖Host头部
+    if (!authority.empty() && !req.hasHeader("Host"))
+        req.headers.push_back(Header{"host", std::move(authority)});
+    if (!cookie.empty())
+        req.headers.push_back(Header{"cookie", std::move(cookie)});
+
+    req.http_version = "HTTP/2";
+    req.remote_addr = remote_addr_;
+    return true;
+}
+
+void Http2Session::endRequest(const shared_ptr<Http2Stream>& stream)
+{
+    if (stream->content_length_ >= 0 &&
+        stream->req_.body.size() != static_cast<size_t>(stream->content_length_)) {
+        resetStream(stream->id_, protocol_error);
+        return;
+    }
+
+    // 与HTTP/1.1相同的检查以及路径、查询参数、范围请求和表单数据的解析
+    auto result = req_parser_.parseHttp2Request(stream->req_, stream->res_);
+    dispatch(stream, result == good);
+}
+
+bool Http2Session::onSettings(uint8_t flags, uint32_t stream_id,
+                    const uint8_t* payload, size_t len)
+{
+    if (stream_id != 0)
+        return connectionError(protocol_error);
+
+    if (flags & ack_flag) {
+        if (len != 0)
+            return connectionError(frame_size_error);
+        return true;
+    }
+
+    if (len % 6 != 0)
+        return connectionError(frame_size_error);
+
+    for (size_t i = 0; i < len; i += 6) {
+        uint32_t id = (uint32_t(payload[i]) << 8) | payload[i + 1];
+        uint32_t value = readUint32(payload + i + 2);
+        switch (id) {
+        case settings_header_table_size:
+            encoder_.setMaxTableSize(value);
+            break;
+        case settings_enable_push:
+            if (value > 1)
+                return connectionError(protocol_error);
+            break;
+        case settings_initial_window_size: {
+            if (value > max_window)
+                return connectionError(flow_control_error);
+            // 调整所有流的发送窗口，窗口可能因此变为负数
+            auto delta = static_cast<int64_t>(value) - peer_initial_window_;
+            for (auto& [id, stream]: streams_) {
+                stream->send_window_ += delta;
+                if (stream->send_window_ > max_window)
+                    return connectionError(flow_control_error);
+            }
+            peer_initial_window_ = value;
+            break;
+        }
+        case settings_max_frame_size:
+            if (value < 16384 || value > 16777215)
+                return connectionError(protocol_error);
+            peer_max_frame_size_ = value;
+            break;
+        default:
+            break;
+        }
+    }
+
+    settings_received_ = true;
+    writeFrameHeader(0, settings_frame, ack_flag, 0);
+    notify(changed_);
+    return true;
+}
+
+bool Http2Session::onRstStream(uint32_t stream_id, const uint8_t* /*payload*/, size_t len)
+{
+    if (stream_id == 0 || stream_id > last_stream_id_)
+        return connectionError(protocol_error);
+    if (len != 4)
+        return connectionError(frame_size_error);
+
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end())
+        return true;
+
+    // 正在处理的流在写操作失败后结束，由处理协程移除
+    auto stream = it->second;
+    stream->reset_ = true;
+    stream->remote_closed_ = true;
+    if (!stream->dispatched_)
+        streams_.erase(it);
+    notify(changed_);
+    return true;
+}
+
+bool Http2Session::onWindowUpdate(uint32_t stream_id, const uint8_t* payload, size_t len)
+{
+    if (len != 4)
+        return connectionError(frame_size_error);
+
+    auto increment = static_cast<int64_t>(readUint32(payload) & 0x7fffffff);
+    if (stream_id == 0) {
+        if (increment == 0)
+            return connectionError(protocol_error);
+        send_window_ += increment;
+        if (send_window_ > max_window)
+            return connectionError(flow_control_error);
+    } else {
+        if (stream_id > last_stream_id_)
+            return connectionError(protocol_error);
+        auto it = streams_.find(stream_id);
+        if (it == streams_.end())
+            return true;
+        auto& stream = *it->second;
+        if (increment == 0) {
+            resetStream(stream_id, protocol_error);
+            return true;
+        }
+        stream.send_window_ += increment;
+        if (stream.send_window_ > max_window) {
+            resetStream(stream_id, flow_control_error);
+            return true;
+        }
+    }
+
+    notify(changed_);
+    return true;
+}
+
+void Http2Session::resetStream(uint32_t stream_id, ErrorCode code)
+{
+    writeRstStream(stream_id, code);
+
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end())
+        return;
+
+    auto stream = it->second;
+    stream->reset_ = true;
+    if (!stream->dispatched_)
+        streams_.erase(it);
+    notify(changed_);
+}
+
+bool Http2Session::connectionError(ErrorCode code)
+{
+    if (!goaway_sent_)
+        writeGoaway(code);
+    closing_ = true;
+
+    // 正在处理的流在写操作失败后结束，其余的流直接移除
+    for (auto it = streams_.begin(); it != streams_.end();) {
+        it->second->reset_ = true;
+        if (it->second->dispatched_)
+            ++it;
+        else
+            it = streams_.erase(it);
+    }
+
+    notify(out_ready_);
+    notify(changed_);
+    return false;
+}
+
+void Http2Session::writeFrameHeader(size_t len, uint8_t type, uint8_t flags,
+                    uint32_t stream_id)
+{
+    out_.push_back(static_cast<char>(len >> 16));
+    out_.push_back(static_cast<char>(len >> 8));
+    out_.push_back(static_cast<char>(len));
+    out_.push_back(static_cast<char>(type));
+    out_.push_back(static_cast<char>(flags));
+    appendUint32(out_, stream_id);
+    notify(out_ready_);
+}
+
+void Http2Session::writeHeaders(uint32_t stream_id, const std::vector<Header>& headers,
+                    bool end_stream)
+{
+    // 头部块必须按编码的顺序发送，因此编码后立即追加到输出缓冲区
+    string block;
+    encoder_.encode(headers, block);
+
+    size_t pos = 0;
+    bool first = true;
+    do {
+        auto n = std::min(block.size() - pos, peer_max_frame_size_);
+        uint8_t flags = 0;
+        if (first && end_stream)
+            flags |= end_stream_flag;
+        if (pos + n == block.size())
+            flags |= end_headers_flag;
+        writeFrameHeader(n, first ? headers_frame : continuation_frame, flags, stream_id);
+        out_.append(block, pos, n);
+        pos += n;
+        first = false;
+    } while (pos < block.size());
+}
+
+void Http2Session::writeSettings()
+{
+    const std::pair<uint32_t, uint32_t> settings[] = {
+        {settings_enable_push, 0},
+        {settings_max_concurrent_streams, static_cast<uint32_t>(opt_.http2MaxConcurrentStreams())},
+        {settings_initial_window_size, static_cast<uint32_t>(receive_window)},
+        {settings_max_header_list_size, static_cast<uint32_t>(max_header_list_size)}
+    };
+
+    writeFrameHeader(sizeof(settings) / sizeof(settings[0]) * 6, settings_frame, 0, 0);
+    for (const auto& setting: settings) {
+        out_.push_back(static_cast<char>(setting.first >> 8));
+        out_.push_back(static_cast<char>(setting.first));
+        appendUint32(out_, setting.second);
+    }
+}
+
+void Http2Session::writeWindowUpdate(uint32_t stream_id, size_t increment)
+{
+    writeFrameHeader(4, window_update_frame, 0, stream_id);
+    appendUint32(out_, static_cast<uint32_t>(increment));
+}
+
+void Http2Session::writeRstStream(uint32_t stream_id, ErrorCode code)
+{
+    writeFrameHeader(4, rst_stream_frame, 0, stream_id);
+    appendUint32(out_, code);
+}
+
+void Http2Session::writeGoaway(ErrorCode code)
+{
+    writeFrameHeader(8, goaway_frame, 0, 0);
+    appendUint32(out_, last_stream_id_);
+    appendUint32(out_, code);
+    goaway_sent_ = true;
+}
+
+} // namespace https_server
\ No newline at end of file
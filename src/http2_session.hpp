@@ -0,0 +1,315 @@
+#pragma once
+
+#include "request.hpp"
+#include "response.hpp"
+#include "response_writer.hpp"
+#include "request_parser.hpp"
+#include "option.hpp"
+#include "hpack.hpp"
+
+#include <asio.hpp>
+#include <openssl/ssl.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace https_server {
+
+class Connection;
+class Http2Session;
+
+// HTTP/2的一个流，对应一对请求和响应
+// 响应头部推迟到第一段响应体或响应结束时才编码发送，
+// 没有响应体时头部帧直接带上END_STREAM
+class Http2Stream : public ResponseWriter {
+public:
+    Http2Stream(Http2Session& session, std::uint32_t id, std::int64_t send_window);
+
+    Http2Stream(const Http2Stream&) = delete;
+    Http2Stream& operator=(const Http2Stream&) = delete;
+
+    // 记录响应头部，去掉HTTP/2中不允许的连接相关头部
+    asio::awaitable<bool> writeHead(const Response& res) override;
+
+    // 数据先在流中累积到一个帧的大小，再以DATA帧发送
+    asio::awaitable<bool> asyncWrite(const char* data, std::size_t len) override;
+
+    // HTTP/2由帧划分数据，不需要分块编码
+    asio::awaitable<bool> writeChunk(const char* data, std::size_t len) override;
+
+    // 流结束时由finish()发送END_STREAM
+    asio::awaitable<bool> writeLastChunk() override;
+
+    asio::awaitable<bool> flush() override;
+
+    // DATA帧需要帧头，不能使用sendfile，读取文件后按普通数据发送
+    asio::awaitable<bool> asyncSendFile(int fd, std::size_t offset, std::size_t length) override;
+
+    // 流已被重置或连接已关闭
+    bool peerClosed() override;
+
+    // 发送剩余的头部和数据并结束流
+    asio::awaitable<bool> finish();
+
+private:
+    friend class Http2Session;
+
+    // 以DATA帧发送数据，受连接和流的发送窗口以及连接输出缓冲区大小的限制
+    // 窗口耗尽或缓冲区已满时挂起
+    asio::awaitable<bool> sendData(const char* data, std::size_t len, bool end_stream);
+
+    // 发送尚未发送的响应头部
+    void sendHead(bool end_stream);
+
+    Http2Session& session_;
+
+    std::uint32_t id_;
+
+    Request req_;
+
+    Response res_;
+
+    // 尚未发送的响应头部
+    std::vector<Header> head_;
+    bool head_pending_ = false;
+
+    // 尚未组成DATA帧的响应体
+    std::string data_;
+
+    // 发送窗口，对端调整SETTINGS_INITIAL_WINDOW_SIZE后可能为负数
+    std::int64_t send_window_;
+
+    // 接收窗口的剩余大小
+    std::int64_t recv_window_;
+
+    // 已收到但尚未通过WINDOW_UPDATE归还给对端的字节数
+    std::size_t recv_unacked_ = 0;
+
+    // 请求头部中的content-length，-1表示没有
+    std::int64_t content_length_ = -1;
+
+    // 已收到END_STREAM，请求接收完毕
+    bool remote_closed_ = false;
+
+    // 已发送END_STREAM，响应发送完毕
+    bool local_closed_ = false;
+
+    // 已收到或发送RST_STREAM
+    bool reset_ = false;
+
+    // 请求已交给RequestHandler处理
+    bool dispatched_ = false;
+};
+
+// 一个HTTP/2连接的帧处理、流的多路复用以及流量控制
+// 每个请求在各自的协程中交给RequestHandler处理，与HTTP/1.1使用相同的服务
+// 所有帧先追加到输出缓冲区，由一个写协程依次写入连接，
+// 同一时刻完成的多个流的帧合并为一次写操作
+// 属于一个Connection，只在连接所在的线程中使用
+class Http2Session {
+public:
+    explicit Http2Session(Connection& conn);
+
+    Http2Session(const Http2Session&) = delete;
+    Http2Session& operator=(const Http2Session&) = delete;
+
+    // 为SSL_CTX安装ALPN回调，客户端支持时优先选择h2，其次为http/1.1
+    static void setupContext(SSL_CTX* ctx);
+
+    // 握手完成后判断是否协商使用了HTTP/2
+    static bool negotiated(SSL* ssl);
+
+    // 读取连接前言和之后的帧，直到连接关闭并且所有的流都已结束
+    asio::awaitable<void> run();
+
+    // 发送GOAWAY，不再接受新的流，已有的流处理完毕后关闭连接
+    void drain();
+
+private:
+    friend class Http2Stream;
+
+    // 帧类型
+    enum FrameType : std::uint8_t {
+        data_frame = 0x0,
+        headers_frame = 0x1,
+        priority_frame = 0x2,
+        rst_stream_frame = 0x3,
+        settings_frame = 0x4,
+        push_promise_frame = 0x5,
+        ping_frame = 0x6,
+        goaway_frame = 0x7,
+        window_update_frame = 0x8,
+        continuation_frame = 0x9
+    };
+
+    // 帧标志
+    enum FrameFlag : std::uint8_t {
+        end_stream_flag = 0x1,
+        ack_flag = 0x1,
+        end_headers_flag = 0x4,
+        padded_flag = 0x8,
+        priority_flag = 0x20
+    };
+
+    // 错误码
+    enum ErrorCode : std::uint32_t {
+        no_error = 0x0,
+        protocol_error = 0x1,
+        internal_error = 0x2,
+        flow_control_error = 0x3,
+        stream_closed = 0x5,
+        frame_size_error = 0x6,
+        refused_stream = 0x7,
+        compression_error = 0x9,
+        enhance_your_calm = 0xb
+    };
+
+    // 写协程，将输出缓冲区中的帧写入连接
+    // 连接正在关闭且所有流结束后，或写操作失败时关闭连接
+    asio::awaitable<void> doWrite();
+
+    // 处理一个请求并发送响应
+    // parsed为false时发送res中状态码对应的固定响应
+    asio::awaitable<void> doStream(std::shared_ptr<Http2Stream> stream, bool parsed);
+
+    // 处理读取到的数据，不完整的帧留到下次读取
+    // 发生连接错误时返回false
+    bool consume(const char* data, std::size_t len);
+
+    // 处理一个完整的帧，发生连接错误时返回false
+    bool processFrame(std::uint8_t type, std::uint8_t flags, std::uint32_t stream_id,
+                    const std::uint8_t* payload, std::size_t len);
+
+    bool onData(std::uint8_t flags, std::uint32_t stream_id,
+                    const std::uint8_t* payload, std::size_t len);
+
+    bool onHeaders(std::uint8_t flags, std::uint32_t stream_id,
+                    const std::uint8_t* payload, std::size_t len);
+
+    bool onContinuation(std::uint8_t flags, const std::uint8_t* payload, std::size_t len);
+
+    // 头部块接收完毕，解码并创建流或处理trailer
+    bool onHeaderBlock();
+
+    bool onSettings(std::uint8_t flags, std::uint32_t stream_id,
+                    const std::uint8_t* payload, std::size_t len);
+
+    bool onRstStream(std::uint32_t stream_id, const std::uint8_t* payload, std::size_t len);
+
+    bool onWindowUpdate(std::uint32_t stream_id, const std::uint8_t* payload, std::size_t len);
+
+    // 检查请求头部并填入req
+    // 伪头部、大写的name、连接相关的头部不符合规范时返回false
+    bool parseHeaders(std::vector<Header>& headers, Http2Stream& stream);
+
+    // 请求接收完毕，检查长度后交给RequestHandler
+    void endRequest(const std::shared_ptr<Http2Stream>& stream);
+
+    // 启动处理请求的协程
+    void dispatch(const std::shared_ptr<Http2Stream>& stream, bool parsed);
+
+    // 发送RST_STREAM，流尚未交给RequestHandler时直接移除
+    void resetStream(std::uint32_t stream_id, ErrorCode code);
+
+    // 发送GOAWAY并关闭连接，返回false
+    bool connectionError(ErrorCode code);
+
+    // 对端发送了数据，按需归还接收窗口
+    void consumeWindow(Http2Stream* stream, std::size_t len);
+
+    // 根据流的状态设置连接的超时阶段
+    void updatePhase();
+
+    void writeFrameHeader(std::size_t len, std::uint8_t type, std::uint8_t flags,
+                    std::uint32_t stream_id);
+
+    // 编码头部并以HEADERS和CONTINUATION帧发送
+    void writeHeaders(std::uint32_t stream_id, const std::vector<Header>& headers,
+                    bool end_stream);
+
+    // 本端的SETTINGS
+    void writeSettings();
+
+    void writeWindowUpdate(std::uint32_t stream_id, std::size_t increment);
+
+    void writeRstStream(std::uint32_t stream_id, ErrorCode code);
+
+    void writeGoaway(ErrorCode code);
+
+    // 唤醒等待signal的协程
+    static void notify(asio::steady_timer& signal);
+
+    // 等待signal被唤醒，唤醒后需要重新检查等待的条件
+    static asio::awaitable<void> wait(asio::steady_timer& signal);
+
+    Connection& conn_;
+
+    const Option& opt_;
+
+    RequestParser req_parser_;
+
+    hpack::Decoder decoder_;
+
+    hpack::Encoder encoder_;
+
+    // 尚未结束的流
+    std::unordered_map<std::uint32_t, std::shared_ptr<Http2Stream>> streams_;
+
+    // 正在由RequestHandler处理的流数
+    std::size_t processing_ = 0;
+
+    // 对端创建的最大流ID
+    std::uint32_t last_stream_id_ = 0;
+
+    // 尚未组成完整帧的数据
+    std::string in_;
+
+    bool preface_received_ = false;
+
+    bool settings_received_ = false;
+
+    // 正在接收头部块的流，0表示没有，此时只能收到该流的CONTINUATION帧
+    std::uint32_t header_stream_id_ = 0;
+    std::uint8_t header_flags_ = 0;
+    std::string header_block_;
+
+    // 连接的发送窗口
+    std::int64_t send_window_ = 65535;
+
+    // 连接的接收窗口的剩余大小
+    std::int64_t recv_window_ = 65535;
+
+    // 已收到但尚未通过WINDOW_UPDATE归还给对端的字节数
+    std::size_t recv_unacked_ = 0;
+
+    // 对端的SETTINGS
+    std::int64_t peer_initial_window_ = 65535;
+    std::size_t peer_max_frame_size_ = 16384;
+
+    // 待写入连接的帧
+    std::string out_;
+
+    // 有新的帧待写入时唤醒写协程
+    asio::steady_timer out_ready_;
+
+    // 窗口增大、输出缓冲区写出、流结束或连接关闭时唤醒等待的协程
+    asio::steady_timer changed_;
+
+    // 已发送GOAWAY，不再接受新的流
+    bool goaway_sent_ = false;
+
+    // 所有的流结束后关闭连接
+    bool closing_ = false;
+
+    // 连接已关闭，所有的写操作都将失败
+    bool closed_ = false;
+
+    bool writer_done_ = false;
+
+    std::string remote_addr_;
+};
+
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,7 @@
+#include "io_context_load.hpp"
+
+namespace https_server {
+
+asio::execution_context::id IoContextLoad::id;
+
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <asio.hpp>
+
+#include <atomic>
+#include <cstddef>
+
+namespace https_server {
+
+// 记录一个io_context上的负载：存活的连接数、正在握手的连接数和正在处理的请求数
+// 通过asio::use_service<IoContextLoad>(io_context)获取，可以在任意线程中读取
+// 连接开始时连接数加一，连接析构时减一
+class IoContextLoad : public asio::execution_context::service
+{
+public:
+    static asio::execution_context::id id;
+
+    explicit IoContextLoad(asio::execution_context& context)
+        : asio::execution_context::service(context) {}
+
+    // 存活的连接数
+    std::size_t connections() const 
+    { 
+        return connections_.load(std::memory_order_relaxed); 
+    }
+
+    void addConnection() 
+    { 
+        connections_.fetch_add(1, std::memory_order_relaxed); 
+    }
+
+    void removeConnection() 
+    { 
+        connections_.fetch_sub(1, std::memory_order_relaxed); 
+    }
+
+    // 正在进行TLS握手的连接数
+    std::size_t handshakes() const
+    {
+        return handshakes_.load(std::memory_order_relaxed);
+    }
+
+    void addHandshake()
+    {
+        handshakes_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void removeHandshake()
+    {
+        handshakes_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // 正在处理的请求数
+    std::size_t requests() const
+    {
+        return requests_.load(std::memory_order_relaxed);
+    }
+
+    void addRequest()
+    {
+        requests_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void removeRequest()
+    {
+        requests_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+private:
+    virtual void shutdown() override {}
+
+    std::atomic<std::size_t> connections_ = 0;
+
+    std::atomic<std::size_t> handshakes_ = 0;
+
+    std::atomic<std::size_t> requests_ = 0;
+};
+
+} // namespace https_server
\ No newline at end of file
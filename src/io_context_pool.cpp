@@ -1,6 +1,8 @@
 #include "io_context_pool.hpp"
+#include "cpu_affinity.hpp"
 
 #include <thread>
+#include <fmt/ranges.h>
 
 using asio::make_work_guard;
 
@@ -19,7 +21,10 @@ IoContextPool::IoContextPool(std::size_t pool_size)
         auto io_context = std::make_shared<asio::io_context>();
         io_contexts_.push_back(io_context);
         work_.push_back(make_work_guard(*io_context));
+        loads_.push_back(&asio::use_service<IoContextLoad>(*io_context));
     }
+
+    random_engine_.seed(std::random_device()());
 }
 
 void IoContextPool::run()
@@ -29,8 +34,20 @@ void IoContextPool::run()
     std::vector<std::shared_ptr<std::thread>> threads;
     for (std::size_t i = 0; i < io_contexts_.size(); ++i) {
         auto cotx = io_contexts_[i];
+
+        // 第一个io_context用于监听和信号，其余的处理连接
+        std::vector<int> cpus;
+        if (i == 0)
+            cpus = acceptor_cpus_;
+        else if (!worker_cpus_.empty())
+            cpus.push_back(worker_cpus_[(i - 1) % worker_cpus_.size()]);
+
         auto thread = std::make_shared<std::thread>(
-            [cotx]() {
+            [cotx, cpus, i]() {
+                // 在运行之前绑定，线程局部的内存分配在本地NUMA节点上
+                // 绑定失败（如容器限制了可用的CPU）时继续在未绑定的线程中运行
+                if (!cpu_affinity::bindCurrentThread(cpus))
+                    fmt::print("Failed to bind thread {} to CPUs {}\n", i, fmt::join(cpus, ","));
                 cotx->run();
             }
         );
@@ -50,8 +67,42 @@ void IoContextPool::stop()
         io_context->stop();
 }
 
+void IoContextPool::set_cpu_affinity(const std::vector<int>& acceptor_cpus,
+                const std::vector<int>& worker_cpus)
+{
+    acceptor_cpus_ = acceptor_cpus;
+    worker_cpus_ = worker_cpus;
+}
+
+void IoContextPool::set_placement_policy(PlacementPolicy policy)
+{
+    placement_policy_ = policy;
+}
+
 asio::io_context& IoContextPool::get_io_context()
 {
+    auto workers = worker_count();
+
+    if (placement_policy_ == PlacementPolicy::PowerOfTwoChoices && workers > 1) {
+        // 随机选择两个不同的io_context，取连接较少的一个
+        std::uniform_int_distribution<std::size_t> dist(0, workers - 1);
+        auto a = dist(random_engine_);
+        auto b = dist(random_engine_);
+        while (b == a)
+            b = dist(random_engine_);
+        auto index = worker_connection_count(a) <= worker_connection_count(b) ? a : b;
+        return get_worker_io_context(index);
+    }
+
+    if (placement_policy_ == PlacementPolicy::LeastConnections) {
+        std::size_t index = 0;
+        for (std::size_t i = 1; i < workers; ++i) {
+            if (worker_connection_count(i) < worker_connection_count(index))
+                index = i;
+        }
+        return get_worker_io_context(index);
+    }
+
     // 采用轮询的方式决定下一个要使用的io_context
     asio::io_context& io_context = *io_contexts_[next_io_context_];
     ++next_io_context_;
@@ -60,6 +111,21 @@ asio::io_context& IoContextPool::get_io_context()
     return io_context;
 }
 
+std::size_t IoContextPool::worker_count() const
+{
+    return io_contexts_.size() - 1;
+}
+
+asio::io_context& IoContextPool::get_worker_io_context(std::size_t index)
+{
+    return *io_contexts_[index + 1];
+}
+
+std::size_t IoContextPool::worker_connection_count(std::size_t index) const
+{
+    return loads_[index + 1]->connections();
+}
+
 asio::io_context& IoContextPool::get_acceptor_singals_io_context()
 {
     // 第一个io_context分配给特定的角色
@@ -1,10 +1,14 @@
 #pragma once
 
+#include "io_context_load.hpp"
+#include "placement_policy.hpp"
+
 #include <asio.hpp>
 
 #include <vector>
 #include <memory>
 #include <list>
+#include <random>
 
 namespace https_server {
 
@@ -23,9 +27,28 @@ public:
     // 停止pool中的所有io_context对象
     void stop();
 
-    // 从pool中获取一个io_context对象使用
+    // 设置线程的CPU亲和性，需要在run()之前调用
+    // acceptor_cpus: 监听和信号线程可以使用的CPU，为空时不绑定
+    // worker_cpus: 第i个处理连接的线程绑定到worker_cpus[i % size]，为空时不绑定
+    void set_cpu_affinity(const std::vector<int>& acceptor_cpus,
+                    const std::vector<int>& worker_cpus);
+
+    // 设置get_io_context()分配新连接的策略，默认为轮询
+    void set_placement_policy(PlacementPolicy policy);
+
+    // 按照分配策略从pool中获取一个io_context对象使用
+    // 只能在一个线程中调用
     asio::io_context& get_io_context();
 
+    // 处理连接的io_context数量，不包括监听和信号专用的io_context
+    std::size_t worker_count() const;
+
+    // 获取第index个处理连接的io_context，index小于worker_count()
+    asio::io_context& get_worker_io_context(std::size_t index);
+
+    // 第index个处理连接的io_context上存活的连接数，即分配策略使用的负载
+    std::size_t worker_connection_count(std::size_t index) const;
+
     // 从pool获取一个专用的io_context
     asio::io_context& get_acceptor_singals_io_context();
 
@@ -38,8 +61,20 @@ private:
 
     std::list<io_context_work> work_;
 
+    // 每个io_context的负载，与io_contexts_一一对应
+    std::vector<IoContextLoad*> loads_;
+
     // 该索引指向下一个连接将要使用的io_context对象的vector索引
     std::size_t next_io_context_;
+
+    PlacementPolicy placement_policy_ = PlacementPolicy::RoundRobin;
+
+    std::vector<int> acceptor_cpus_;
+
+    std::vector<int> worker_cpus_;
+
+    // 用于PowerOfTwoChoices随机选择io_context
+    std::minstd_rand random_engine_;
 };
 
 } // namespace https_server
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include "ktls.hpp"
+
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+
+#include <cstring>
+#include <string>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/tls.h>
+#endif
+
+using std::string;
+using std::vector;
+
+namespace https_server {
+namespace ktls {
+
+namespace {
+
+// 当前连接关联的HandshakeState在SSL ex_data中的索引
+int stateIndex()
+{
+    static const int index = ::SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+HandshakeState* getState(const SSL* ssl)
+{
+    return static_cast<HandshakeState*>(::SSL_get_ex_data(ssl, stateIndex()));
+}
+
+// 统计切换发送密钥之后写出的记录数，即下一个记录的序列号
+// 发送方向交给内核后，检查收到的KeyUpdate
+void onMessage(int write_p, int /*version*/, int content_type,
+            const void* buf, std::size_t len, SSL* ssl, void* /*arg*/)
+{
+    auto state = getState(ssl);
+    if (!state)
+        return;
+
+    if (!write_p) {
+#if defined(__linux__)
+        // 对端要求更新密钥时，OpenSSL会在用户态加密并发送KeyUpdate，
+        // 与内核的记录序列冲突，内核的发送密钥也无法随之更新，只能关闭连接
+        // 回调在处理消息之前调用，关闭后OpenSSL的KeyUpdate不会被发出
+        auto msg = static_cast<const unsigned char*>(buf);
+        if (state->tx_fd >= 0 && content_type == SSL3_RT_HANDSHAKE && len >= 5 &&
+            msg[0] == SSL3_MT_KEY_UPDATE && msg[4] == SSL_KEY_UPDATE_REQUESTED)
+            ::shutdown(state->tx_fd, SHUT_RDWR);
+#endif
+        return;
+    }
+
+    if (content_type == SSL3_RT_HEADER) {
+        ++state->records_after_ccs;
+        ++state->records_after_secret;
+    } else if (content_type == SSL3_RT_CHANGE_CIPHER_SPEC) {
+        // 记录头的回调先于ChangeCipherSpec消息的回调，
+        // 因此这里清零后，下一个记录（Finished）的序列号为0
+        state->records_after_ccs = 0;
+    }
+}
+
+bool fromHex(const string& hex, vector<unsigned char>& out)
+{
+    if (hex.size() % 2 != 0)
+        return false;
+
+    out.clear();
+    for (std::size_t i = 0; i < hex.size(); i += 2) {
+        try {
+            out.push_back(static_cast<unsigned char>(
+                std::stoi(hex.substr(i, 2), nullptr, 16)));
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 从keylog中获取TLS1.3服务端应用数据流量密钥
+// 格式为: SERVER_TRAFFIC_SECRET_0 <client_random> <secret>
+void onKeylog(const SSL* ssl, const char* line)
+{
+    static const string label = "SERVER_TRAFFIC_SECRET_0 ";
+
+    auto state = getState(ssl);
+    if (!state || std::strncmp(line, label.c_str(), label.size()) != 0)
+        return;
+
+    string s(line + label.size());
+    auto pos = s.find(' ');
+    if (pos == string::npos)
+        return;
+
+    if (fromHex(s.substr(pos + 1), state->server_traffic_secret))
+        state->records_after_secret = 0;
+}
+
+// 发送方向的密钥材料
+struct TxKeys
+{
+    int version;
+    std::size_t key_len;
+    unsigned char key[32];
+    unsigned char salt[4];
+    unsigned char iv[8];
+    std::uint64_t seq;
+};
+
+// TLS1.3 HKDF-Expand-Label(secret, label, "", out_len)
+bool hkdfExpandLabel(const EVP_MD* md, const vector<unsigned char>& secret,
+                const string& label, unsigned char* out, std::size_t out_len)
+{
+    string full_label = "tls13 " + label;
+    vector<unsigned char> info;
+    info.push_back(static_cast<unsigned char>(out_len >> 8));
+    info.push_back(static_cast<unsigned char>(out_len & 0xff));
+    info.push_back(static_cast<unsigned char>(full_label.size()));
+    info.insert(info.end(), full_label.begin(), full_label.end());
+    info.push_back(0);
+
+    EVP_PKEY_CTX* pctx = ::EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+    if (!pctx)
+        return false;
+
+    bool ok = ::EVP_PKEY_derive_init(pctx) > 0 &&
+        ::EVP_PKEY_CTX_set_hkdf_mode(pctx, EVP_PKEY_HKDEF_MODE_EXPAND_ONLY) > 0 &&
+        ::EVP_PKEY_CTX_set_hkdf_md(pctx, md) > 0 &&
+        ::EVP_PKEY_CTX_set1_hkdf_key(pctx, secret.data(), secret.size()) > 0 &&
+        ::EVP_PKEY_CTX_add1_hkdf_info(pctx, info.data(), info.size()) > 0 &&
+        ::EVP_PKEY_derive(pctx, out, &out_len) > 0;
+
+    ::EVP_PKEY_CTX_free(pctx);
+    return ok;
+}
+
+// TLS1.2 PRF(master_secret, "key expansion", server_random + client_random)
+bool tls12KeyBlock(SSL* ssl, const EVP_MD* md, unsigned char* out, std::size_t out_len)
+{
+    unsigned char master[SSL_MAX_MASTER_KEY_LENGTH];
+    unsigned char client_random[SSL3_RANDOM_SIZE];
+    unsigned char server_random[SSL3_RANDOM_SIZE];
+
+    auto master_len = ::SSL_SESSION_get_master_key(::SSL_get_session(ssl),
+                                    master, sizeof(master));
+    ::SSL_get_client_random(ssl, client_random, sizeof(client_random));
+    ::SSL_get_server_random(ssl, server_random, sizeof(server_random));
+
+    static const char label[] = "key expansion";
+
+    EVP_PKEY_CTX* pctx = ::EVP_PKEY_CTX_new_id(EVP_PKEY_TLS1_PRF, nullptr);
+    if (!pctx)
+        return false;
+
+    bool ok = ::EVP_PKEY_derive_init(pctx) > 0 &&
+        ::EVP_PKEY_CTX_set_tls1_prf_md(pctx, md) > 0 &&
+        ::EVP_PKEY_CTX_set1_tls1_prf_secret(pctx, master, master_len) > 0 &&
+        ::EVP_PKEY_CTX_add1_tls1_prf_seed(pctx,
+            reinterpret_cast<const unsigned char*>(label), sizeof(label) - 1) > 0 &&
+        ::EVP_PKEY_CTX_add1_tls1_prf_seed(pctx, server_random, sizeof(server_random)) > 0 &&
+        ::EVP_PKEY_CTX_add1_tls1_prf_seed(pctx, client_random, sizeof(client_random)) > 0 &&
+        ::EVP_PKEY_derive(pctx, out, &out_len) > 0;
+
+    ::EVP_PKEY_CTX_free(pctx);
+    ::OPENSSL_cleanse(master, sizeof(master));
+    return ok;
+}
+
+void storeSeq(std::uint64_t seq, unsigned char* out)
+{
+    for (int i = 7; i >= 0; --i) {
+        out[i] = static_cast<unsigned char>(seq & 0xff);
+        seq >>= 8;
+    }
+}
+
+// 导出服务端发送方向的密钥、盐值和序列号
+bool exportTxKeys(SSL* ssl, const HandshakeState& state, TxKeys& keys)
+{
+    const SSL_CIPHER* cipher = ::SSL_get_current_cipher(ssl);
+    if (!cipher)
+        return false;
+
+    auto nid = ::SSL_CIPHER_get_cipher_nid(cipher);
+    if (nid == NID_aes_128_gcm)
+        keys.key_len = 16;
+    else if (nid == NID_aes_256_gcm)
+        keys.key_len = 32;
+    else
+        return false;
+
+    const EVP_MD* md = ::SSL_CIPHER_get_handshake_digest(cipher);
+    if (!md)
+        return false;
+
+    keys.version = ::SSL_version(ssl);
+    if (keys.version == TLS1_3_VERSION) {
+        if (state.server_traffic_secret.empty())
+            return false;
+
+        unsigned char iv[12];
+        if (!hkdfExpandLabel(md, state.server_traffic_secret, "key",
+                        keys.key, keys.key_len) ||
+            !hkdfExpandLabel(md, state.server_traffic_secret, "iv",
+                        iv, sizeof(iv)))
+            return false;
+
+        std::memcpy(keys.salt, iv, 4);
+        std::memcpy(keys.iv, iv + 4, 8);
+        keys.seq = state.records_after_secret;
+    } else if (keys.version == TLS1_2_VERSION) {
+        // key block: client_key | server_key | client_iv(4) | server_iv(4)
+        unsigned char key_block[2 * 32 + 2 * 4];
+        std::size_t block_len = 2 * keys.key_len + 2 * 4;
+        if (!tls12KeyBlock(ssl, md, key_block, block_len))
+            return false;
+
+        std::memcpy(keys.key, key_block + keys.key_len, keys.key_len);
+        std::memcpy(keys.salt, key_block + 2 * keys.key_len + 4, 4);
+        keys.seq = state.records_after_ccs;
+        // 显式nonce只需保证在同一密钥下不重复，这里使用记录序列号
+        storeSeq(keys.seq, keys.iv);
+        ::OPENSSL_cleanse(key_block, sizeof(key_block));
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+#if defined(__linux__) && defined(TLS_TX)
+template <typename CryptoInfo>
+bool installTx(int fd, const TxKeys& keys, unsigned short cipher_type)
+{
+    CryptoInfo crypto_info;
+    std::memset(&crypto_info, 0, sizeof(crypto_info));
+    crypto_info.info.version = keys.version == TLS1_3_VERSION
+                            ? TLS_1_3_VERSION : TLS_1_2_VERSION;
+    crypto_info.info.cipher_type = cipher_type;
+    std::memcpy(crypto_info.key, keys.key, keys.key_len);
+    std::memcpy(crypto_info.salt, keys.salt, sizeof(crypto_info.salt));
+    std::memcpy(crypto_info.iv, keys.iv, sizeof(crypto_info.iv));
+    storeSeq(keys.seq, crypto_info.rec_seq);
+
+    bool ok = ::setsockopt(fd, SOL_TLS, TLS_TX,
+                    &crypto_info, sizeof(crypto_info)) == 0;
+    ::OPENSSL_cleanse(&crypto_info, sizeof(crypto_info));
+    return ok;
+}
+#endif
+
+} // namespace
+
+void setupContext(SSL_CTX* ctx)
+{
+    // 内核接管发送方向后，用户态不能再发送任何握手消息
+    ::SSL_CTX_set_options(ctx, SSL_OP_NO_RENEGOTIATION);
+    ::SSL_CTX_set_keylog_callback(ctx, onKeylog);
+}
+
+void attach(SSL* ssl, HandshakeState& state)
+{
+    ::SSL_set_ex_data(ssl, stateIndex(), &state);
+    ::SSL_set_msg_callback(ssl, onMessage);
+}
+
+bool enableTx(SSL* ssl, int fd, HandshakeState& state)
+{
+    bool ok = false;
+
+#if defined(__linux__) && defined(TLS_TX)
+    TxKeys keys;
+    // 内核未加载tls模块时失败
+    if (exportTxKeys(ssl, state, keys) &&
+        ::setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) == 0) {
+        ok = keys.key_len == 16
+            ? installTx<tls12_crypto_info_aes_gcm_128>(fd, keys, TLS_CIPHER_AES_GCM_128)
+            : installTx<tls12_crypto_info_aes_gcm_256>(fd, keys, TLS_CIPHER_AES_GCM_256);
+    }
+    ::OPENSSL_cleanse(&keys, sizeof(keys));
+#endif
+
+    // 握手已经完成，不再需要统计记录数
+    // TLS1.3保留回调，用于发现对端要求更新密钥的KeyUpdate，TLS1.2已禁用重协商
+    if (ok && ::SSL_version(ssl) == TLS1_3_VERSION)
+        state.tx_fd = fd;
+    else
+        ::SSL_set_msg_callback(ssl, nullptr);
+    return ok;
+}
+
+} // namespace ktls
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <openssl/ssl.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace https_server {
+namespace ktls {
+
+// 握手过程中收集的发送方向密钥信息
+// asio的ssl::stream使用BIO pair，OpenSSL无法自行启用kTLS，
+// 因此需要在握手完成后手动导出密钥和记录序列号交给内核
+struct HandshakeState
+{
+    // TLS1.3服务端应用数据流量密钥
+    std::vector<unsigned char> server_traffic_secret;
+
+    // TLS1.2发送ChangeCipherSpec之后已发送的记录数
+    std::uint64_t records_after_ccs = 0;
+
+    // TLS1.3派生出应用数据流量密钥之后已发送的记录数
+    std::uint64_t records_after_secret = 0;
+
+    // TLS1.3发送方向交给内核后的socket，否则为-1
+    // 收到要求更新密钥的KeyUpdate时关闭该socket
+    int tx_fd = -1;
+};
+
+// 为SSL_CTX安装收集密钥所需的回调，并禁用重协商
+void setupContext(SSL_CTX* ctx);
+
+// 在握手开始前将state与ssl关联，state的生命周期必须覆盖整个握手过程
+void attach(SSL* ssl, HandshakeState& state);
+
+// 握手完成后尝试将发送方向的加密交给内核
+// 只支持AES-GCM加密套件，内核或加密套件不支持时返回false，
+// 此时应继续使用OpenSSL在用户态加密
+// 返回true后，所有发送的数据都必须以明文直接写入fd，由内核完成加密
+// 内核的发送密钥无法更新，TLS1.3连接的对端要求更新密钥（KeyUpdate）时直接关闭连接
+bool enableTx(SSL* ssl, int fd, HandshakeState& state);
+
+} // namespace ktls
+} // namespace https_server
\ No newline at end of file
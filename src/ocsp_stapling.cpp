@@ -0,0 +1,235 @@
+#include "ocsp_stapling.hpp"
+
+#include <openssl/ocsp.h>
+#include <openssl/pem.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <fmt/format.h>
+
+using std::string;
+
+namespace https_server {
+
+OcspStapling::Entry::~Entry()
+{
+    ::X509_free(cert);
+}
+
+OcspStapling::OcspStapling(const Option& opt)
+    : provider_(opt.ocspResponseProvider()),
+      refresh_interval_(std::chrono::seconds(std::max<std::size_t>(1, opt.ocspRefreshInterval()))),
+      retry_interval_(std::min<clock_type::duration>(refresh_interval_, std::chrono::seconds(60))) {}
+
+OcspStapling::~OcspStapling()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+
+    if (thread_.joinable())
+        thread_.join();
+}
+
+int OcspStapling::contextIndex()
+{
+    static const int index = ::SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, freeEntries);
+    return index;
+}
+
+void OcspStapling::freeEntries(void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+{
+    delete static_cast<Entries*>(ptr);
+}
+
+void OcspStapling::setupContext(SSL_CTX* ctx, const string& crt_file_path,
+                    const string& response_file_path)
+{
+    if (response_file_path.empty() && !provider_)
+        return;
+
+    // 证书文件中的第一个证书是服务器证书，文件已由SSL_CTX成功加载
+    auto entry = std::make_shared<Entry>();
+    if (auto bio = ::BIO_new_file(crt_file_path.c_str(), "r")) {
+        entry->cert = ::PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+        ::BIO_free(bio);
+    }
+    if (entry->cert == nullptr)
+        return;
+
+    entry->crt_file_path = crt_file_path;
+    entry->response_file_path = response_file_path;
+
+    // 在开始接受连接之前获取，之后的握手都能附带响应
+    refresh(*entry);
+
+    auto entries = static_cast<Entries*>(::SSL_CTX_get_ex_data(ctx, contextIndex()));
+    if (entries == nullptr) {
+        entries = new Entries;
+        ::SSL_CTX_set_ex_data(ctx, contextIndex(), entries);
+        ::SSL_CTX_set_tlsext_status_cb(ctx, onStatus);
+    }
+    entries->push_back(entry);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.push_back(entry);
+        if (!thread_.joinable())
+            thread_ = std::thread([this] { refreshLoop(); });
+    }
+    cv_.notify_one();
+}
+
+int OcspStapling::onStatus(SSL* ssl, void*)
+{
+    // 按SNI切换上下文后，这里是切换后的上下文
+    auto entries = static_cast<Entries*>(
+                ::SSL_CTX_get_ex_data(::SSL_get_SSL_CTX(ssl), contextIndex()));
+    auto cert = ::SSL_get_certificate(ssl);
+    if (entries == nullptr || cert == nullptr)
+        return SSL_TLSEXT_ERR_NOACK;
+
+    // 同时加载ECDSA证书时，只附带服务器所选证书的响应
+    for (auto& entry: *entries) {
+        if (::X509_cmp(entry->cert, cert) != 0)
+            continue;
+
+        std::shared_ptr<const string> response;
+        {
+            std::lock_guard<std::mutex> lock(entry->mutex);
+            if (entry->expiry > clock_type::now())
+                response = entry->response;
+        }
+        if (!response)
+            return SSL_TLSEXT_ERR_NOACK;
+
+        // 由OpenSSL在发送后释放
+        auto data = static_cast<unsigned char*>(::OPENSSL_malloc(response->size()));
+        if (data == nullptr)
+            return SSL_TLSEXT_ERR_NOACK;
+        std::memcpy(data, response->data(), response->size());
+        ::SSL_set_tlsext_status_ocsp_resp(ssl, data, static_cast<long>(response->size()));
+        return SSL_TLSEXT_ERR_OK;
+    }
+    return SSL_TLSEXT_ERR_NOACK;
+}
+
+void OcspStapling::refresh(Entry& entry)
+{
+    string response;
+    clock_type::duration valid_for {};
+    auto now = clock_type::now();
+
+    if (!fetch(entry, response, valid_for)) {
+        fmt::print("Failed to load OCSP response for {}\n", entry.crt_file_path);
+        entry.next_refresh = now + retry_interval_;
+        return;
+    }
+
+    // 最晚在剩余有效期过半时重新获取，为失败后的重试留出时间
+    entry.next_refresh = now + std::min(refresh_interval_, valid_for / 2);
+
+    std::lock_guard<std::mutex> lock(entry.mutex);
+    entry.response = std::make_shared<const string>(std::move(response));
+    entry.expiry = now + valid_for;
+}
+
+bool OcspStapling::fetch(const Entry& entry, string& response,
+                    clock_type::duration& valid_for) const
+{
+    if (provider_) {
+        response = provider_(entry.crt_file_path);
+    } else {
+        std::ifstream in(entry.response_file_path, std::ios::binary);
+        response.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    if (response.empty())
+        return false;
+
+    auto p = reinterpret_cast<const unsigned char*>(response.data());
+    std::unique_ptr<OCSP_RESPONSE, decltype(&::OCSP_RESPONSE_free)> resp(
+        ::d2i_OCSP_RESPONSE(nullptr, &p, static_cast<long>(response.size())), 
+        ::OCSP_RESPONSE_free);
+    if (!resp || ::OCSP_response_status(resp.get()) != OCSP_RESPONSE_STATUS_SUCCESSFUL)
+        return false;
+
+    std::unique_ptr<OCSP_BASICRESP, decltype(&::OCSP_BASICRESP_free)> basic(
+        ::OCSP_response_get1_basic(resp.get()), ::OCSP_BASICRESP_free);
+    if (!basic)
+        return false;
+
+    // 按序列号找到本证书的状态，避免附带其它证书的响应
+    auto serial = ::X509_get0_serialNumber(entry.cert);
+    for (int i = 0; i < ::OCSP_resp_count(basic.get()); ++i) {
+        auto single = ::OCSP_resp_get0(basic.get(), i);
+        ASN1_INTEGER* id_serial = nullptr;
+        ::OCSP_id_get0_info(nullptr, nullptr, nullptr, &id_serial, 
+            const_cast<OCSP_CERTID*>(::OCSP_SINGLERESP_get0_id(single)));
+        if (id_serial == nullptr || ::ASN1_INTEGER_cmp(id_serial, serial) != 0)
+            continue;
+
+        ASN1_GENERALIZEDTIME* next_update = nullptr;
+        if (::OCSP_single_get0_status(single, nullptr, nullptr, nullptr, &next_update) < 0)
+            return false;
+
+        // 没有nextUpdate表示随时可以获取新的状态
+        if (next_update == nullptr) {
+            valid_for = refresh_interval_;
+            return true;
+        }
+
+        int days = 0;
+        int seconds = 0;
+        if (!::ASN1_TIME_diff(&days, &seconds, nullptr, next_update))
+            return false;
+        auto remaining = std::chrono::hours(24) * days + std::chrono::seconds(seconds);
+        if (remaining <= clock_type::duration::zero())
+            return false;
+
+        valid_for = remaining;
+        return true;
+    }
+    return false;
+}
+
+void OcspStapling::refreshLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopped_) {
+        // 移除已随SSL_CTX释放的证书，找出需要刷新的证书
+        std::erase_if(entries_, [](const auto& entry) { return entry.expired(); });
+
+        auto now = clock_type::now();
+        auto next = clock_type::time_point::max();
+        std::vector<std::shared_ptr<Entry>> due;
+        for (const auto& weak: entries_) {
+            if (auto entry = weak.lock()) {
+                if (entry->next_refresh <= now)
+                    due.push_back(std::move(entry));
+                else
+                    next = std::min(next, entry->next_refresh);
+            }
+        }
+
+        if (due.empty()) {
+            if (next == clock_type::time_point::max())
+                cv_.wait(lock);
+            else
+                cv_.wait_until(lock, next);
+            continue;
+        }
+
+        // 获取响应时不持有锁，provider可能会阻塞
+        lock.unlock();
+        for (auto& entry: due)
+            refresh(*entry);
+        due.clear();
+        lock.lock();
+    }
+}
+
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "option.hpp"
+
+#include <openssl/ssl.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace https_server {
+
+// OCSP装订
+// 证书的OCSP响应从文件或Option::ocspResponseProvider获取后缓存在内存中，
+// 客户端在握手中请求证书状态时直接附带缓存的响应，握手过程中不会读取文件或请求响应
+// 后台线程在响应过期之前定期重新获取，获取失败时继续使用原来的响应直到过期
+class OcspStapling
+{
+public:
+    explicit OcspStapling(const Option& opt);
+
+    OcspStapling(const OcspStapling&) = delete;
+    OcspStapling& operator=(const OcspStapling&) = delete;
+
+    // 停止后台线程
+    ~OcspStapling();
+
+    // 为SSL_CTX中crt_file_path对应的证书启用OCSP装订，同时加载ECDSA证书时分别调用
+    // response_file_path为空且没有设置Option::ocspResponseProvider时不做任何操作
+    // 立即获取一次响应，失败时由后台线程重试，此时握手不附带响应
+    void setupContext(SSL_CTX* ctx, const std::string& crt_file_path,
+                    const std::string& response_file_path);
+
+private:
+    using clock_type = std::chrono::steady_clock;
+
+    // 一个证书的OCSP响应
+    struct Entry
+    {
+        Entry() = default;
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+        ~Entry();
+
+        // 证书，握手时与服务器选择的证书比较
+        X509* cert = nullptr;
+
+        std::string crt_file_path;
+        std::string response_file_path;
+
+        // 保护response和expiry
+        std::mutex mutex;
+
+        // DER编码的响应，为空表示还没有可用的响应
+        std::shared_ptr<const std::string> response;
+
+        // 响应的过期时间（nextUpdate）
+        clock_type::time_point expiry;
+
+        // 下次获取响应的时间，只在后台线程和setupContext中访问
+        clock_type::time_point next_refresh;
+    };
+
+    // 一个SSL_CTX上启用了装订的证书，保存在SSL_CTX的ex_data中，随SSL_CTX释放
+    using Entries = std::vector<std::shared_ptr<Entry>>;
+
+    static int contextIndex();
+
+    static void freeEntries(void* parent, void* ptr, CRYPTO_EX_DATA* ad,
+                        int index, long argl, void* argp);
+
+    // 握手时附带与服务器所选证书对应且未过期的响应
+    static int onStatus(SSL* ssl, void* arg);
+
+    // 获取并检查响应，成功时替换缓存的响应，并设置下次获取的时间
+    void refresh(Entry& entry);
+
+    // 读取响应并检查其与证书匹配且未过期，失败时返回false
+    bool fetch(const Entry& entry, std::string& response, 
+            clock_type::duration& valid_for) const;
+
+    void refreshLoop();
+
+    OcspResponseProvider provider_;
+
+    // 没有设置nextUpdate的响应的刷新间隔，也是刷新间隔的上限
+    clock_type::duration refresh_interval_;
+
+    // 获取失败后重试的间隔
+    clock_type::duration retry_interval_;
+
+    // 保护以下成员，后台线程在cv_上等待下一次刷新
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    // 所有启用了装订的证书，SSL_CTX释放后自动失效
+    std::vector<std::weak_ptr<Entry>> entries_;
+
+    bool stopped_ = false;
+
+    // 第一次启用装订时创建
+    std::thread thread_;
+};
+
+} // namespace https_server
\ No newline at end of file
@@ -34,6 +34,121 @@ void Option::setPrivateKeyPwd(const string& pwd)
     private_key_pwd_ = pwd;
 }
 
+string Option::ecdsaCrtFilePath() const
+{
+    return ecdsa_crt_file_path_;
+}
+
+void Option::setEcdsaCrtFilePath(const string& path)
+{
+    ecdsa_crt_file_path_ = path;
+}
+
+string Option::ecdsaPrivateKeyFilePath() const
+{
+    return ecdsa_private_key_file_path_;
+}
+
+void Option::setEcdsaPrivateKeyFilePath(const string& path)
+{
+    ecdsa_private_key_file_path_ = path;
+}
+
+string Option::cipherList() const
+{
+    return cipher_list_;
+}
+
+void Option::setCipherList(const string& ciphers)
+{
+    cipher_list_ = ciphers;
+}
+
+string Option::cipherSuites() const
+{
+    return cipher_suites_;
+}
+
+void Option::setCipherSuites(const string& suites)
+{
+    cipher_suites_ = suites;
+}
+
+string Option::groups() const
+{
+    return groups_;
+}
+
+void Option::setGroups(const string& groups)
+{
+    groups_ = groups;
+}
+
+bool Option::preferServerCiphers() const
+{
+    return prefer_server_ciphers_;
+}
+
+void Option::setPreferServerCiphers(const bool enable)
+{
+    prefer_server_ciphers_ = enable;
+}
+
+string Option::ocspResponseFilePath() const
+{
+    return ocsp_response_file_path_;
+}
+
+void Option::setOcspResponseFilePath(const string& path)
+{
+    ocsp_response_file_path_ = path;
+}
+
+string Option::ecdsaOcspResponseFilePath() const
+{
+    return ecdsa_ocsp_response_file_path_;
+}
+
+void Option::setEcdsaOcspResponseFilePath(const string& path)
+{
+    ecdsa_ocsp_response_file_path_ = path;
+}
+
+OcspResponseProvider Option::ocspResponseProvider() const
+{
+    return ocsp_response_provider_;
+}
+
+void Option::setOcspResponseProvider(const OcspResponseProvider& provider)
+{
+    ocsp_response_provider_ = provider;
+}
+
+std::size_t Option::ocspRefreshInterval() const
+{
+    return ocsp_refresh_interval_;
+}
+
+void Option::setOcspRefreshInterval(const std::size_t interval)
+{
+    ocsp_refresh_interval_ = interval;
+}
+
+std::vector<HostCertificate> Option::hostCertificates() const
+{
+    return host_certificates_;
+}
+
+void Option::setHostCertificates(const std::vector<HostCertificate>& certificates)
+{
+    host_certificates_ = certificates;
+}
+
+void Option::addHostCertificate(const HostCertificate& certificate)
+{
+    host_certificates_.push_back(certificate);
+}
+
 std::size_t Option::connectionTimeout() const 
 {
     return connection_timeout_;
@@ -44,6 +159,56 @@ void Option::setConnectionTimeout(const std::size_t timeout)
     connection_timeout_ = timeout;
 }
 
+std::size_t Option::idleTimeout() const
+{
+    return idle_timeout_;
+}
+
+void Option::setIdleTimeout(const std::size_t timeout)
+{
+    idle_timeout_ = timeout;
+}
+
+std::size_t Option::handshakeTimeout() const
+{
+    return handshake_timeout_;
+}
+
+void Option::setHandshakeTimeout(const std::size_t timeout)
+{
+    handshake_timeout_ = timeout;
+}
+
+std::size_t Option::requestHeaderTimeout() const
+{
+    return request_header_timeout_;
+}
+
+void Option::setRequestHeaderTimeout(const std::size_t timeout)
+{
+    request_header_timeout_ = timeout;
+}
+
+std::size_t Option::requestBodyTimeout() const
+{
+    return request_body_timeout_;
+}
+
+void Option::setRequestBodyTimeout(const std::size_t timeout)
+{
+    request_body_timeout_ = timeout;
+}
+
+std::size_t Option::requestBodyMinRate() const
+{
+    return request_body_min_rate_;
+}
+
+void Option::setRequestBodyMinRate(const std::size_t rate)
+{
+    request_body_min_rate_ = rate;
+}
+
 void Option::setUriMaxLength(const std::size_t l)
 {
     uri_max_length_ = l;
@@ -64,6 +229,16 @@ std::size_t Option::requestMaxLength() const
     return request_max_length_;
 }
 
+std::size_t Option::writeBufferSize() const
+{
+    return write_buffer_size_;
+}
+
+void Option::setWriteBufferSize(const std::size_t size)
+{
+    write_buffer_size_ = size;
+}
+
 EncodingType Option::encodingType() const
 {
     return encoding_type_;
@@ -74,4 +249,194 @@ void Option::setEncodingType(const EncodingType& e)
     encoding_type_ = e;
 }
 
+bool Option::ktls() const
+{
+    return ktls_;
+}
+
+void Option::setKtls(const bool enable)
+{
+    ktls_ = enable;
+}
+
+bool Option::reusePort() const
+{
+    return reuse_port_;
+}
+
+void Option::setReusePort(const bool enable)
+{
+    reuse_port_ = enable;
+}
+
+PlacementPolicy Option::placementPolicy() const
+{
+    return placement_policy_;
+}
+
+void Option::setPlacementPolicy(const PlacementPolicy& policy)
+{
+    placement_policy_ = policy;
+}
+
+std::size_t Option::drainTimeout() const
+{
+    return drain_timeout_;
+}
+
+void Option::setDrainTimeout(const std::size_t timeout)
+{
+    drain_timeout_ = timeout;
+}
+
+std::size_t Option::workerPoolSize() const
+{
+    return worker_pool_size_;
+}
+
+void Option::setWorkerPoolSize(const std::size_t size)
+{
+    worker_pool_size_ = size;
+}
+
+std::vector<int> Option::acceptorCpus() const
+{
+    return acceptor_cpus_;
+}
+
+void Option::setAcceptorCpus(const std::vector<int>& cpus)
+{
+    acceptor_cpus_ = cpus;
+}
+
+std::vector<int> Option::workerCpus() const
+{
+    return worker_cpus_;
+}
+
+void Option::setWorkerCpus(const std::vector<int>& cpus)
+{
+    worker_cpus_ = cpus;
+}
+
+std::size_t Option::maxConnections() const
+{
+    return max_connections_;
+}
+
+void Option::setMaxConnections(const std::size_t n)
+{
+    max_connections_ = n;
+}
+
+std::size_t Option::maxConnectionsPerThread() const
+{
+    return max_connections_per_thread_;
+}
+
+void Option::setMaxConnectionsPerThread(const std::size_t n)
+{
+    max_connections_per_thread_ = n;
+}
+
+std::size_t Option::maxHandshakes() const
+{
+    return max_handshakes_;
+}
+
+void Option::setMaxHandshakes(const std::size_t n)
+{
+    max_handshakes_ = n;
+}
+
+std::size_t Option::maxHandshakesPerThread() const
+{
+    return max_handshakes_per_thread_;
+}
+
+void Option::setMaxHandshakesPerThread(const std::size_t n)
+{
+    max_handshakes_per_thread_ = n;
+}
+
+std::size_t Option::maxRequests() const
+{
+    return max_requests_;
+}
+
+void Option::setMaxRequests(const std::size_t n)
+{
+    max_requests_ = n;
+}
+
+std::size_t Option::maxRequestsPerThread() const
+{
+    return max_requests_per_thread_;
+}
+
+void Option::setMaxRequestsPerThread(const std::size_t n)
+{
+    max_requests_per_thread_ = n;
+}
+
+std::size_t Option::sessionCacheSize() const
+{
+    return session_cache_size_;
+}
+
+void Option::setSessionCacheSize(const std::size_t size)
+{
+    session_cache_size_ = size;
+}
+
+std::size_t Option::sessionTimeout() const
+{
+    return session_timeout_;
+}
+
+void Option::setSessionTimeout(const std::size_t timeout)
+{
+    session_timeout_ = timeout;
+}
+
+bool Option::sessionTickets() const
+{
+    return session_tickets_;
+}
+
+void Option::setSessionTickets(const bool enable)
+{
+    session_tickets_ = enable;
+}
+
+std::size_t Option::sessionTicketKeyRotation() const
+{
+    return session_ticket_key_rotation_;
+}
+
+void Option::setSessionTicketKeyRotation(const std::size_t interval)
+{
+    session_ticket_key_rotation_ = interval;
+}
+
+bool Option::http2() const
+{
+    return http2_;
+}
+
+void Option::setHttp2(const bool enable)
+{
+    http2_ = enable;
+}
+
+std::size_t Option::http2MaxConcurrentStreams() const
+{
+    return http2_max_concurrent_streams_;
+}
+
+void Option::setHttp2MaxConcurrentStreams(const std::size_t n)
+{
+    http2_max_concurrent_streams_ = n;
+}
+
 } // namespace https_server
\ No newline at end of file
@@ -1,11 +1,19 @@
 #pragma once
 
 #include "encoding_type.hpp"
+#include "placement_policy.hpp"
+#include "host_certificate.hpp"
 
+#include <functional>
 #include <string>
+#include <vector>
 
 namespace https_server {
 
+// 获取证书的DER格式OCSP响应，参数是证书文件路径，失败时返回空字符串
+// 在后台线程中调用，可以阻塞
+using OcspResponseProvider = std::function<std::string(const std::string& crt_file_path)>;
+
 class Option
 {
 private:
@@ -18,18 +26,142 @@ private:
     // 私钥密码
     std::string private_key_pwd_ = "";
 
-    // 0表示永不超时
+    // 可选的ECDSA证书和私钥文件路径，为空时只使用上面的证书
+    // 设置后两个证书同时加载，支持ECDSA签名的客户端使用签名开销更小的ECDSA证书，
+    // 其余的客户端使用上面的证书（通常是RSA），私钥密码与上面的相同
+    std::string ecdsa_crt_file_path_;
+    std::string ecdsa_private_key_file_path_;
+
+    // TLS 1.2及以下使用的加密套件，OpenSSL的格式，为空时使用OpenSSL的默认值
+    std::string cipher_list_;
+
+    // TLS 1.3使用的加密套件，如"TLS_AES_128_GCM_SHA256:TLS_CHACHA20_POLY1305_SHA256"
+    // 为空时使用OpenSSL的默认值
+    std::string cipher_suites_;
+
+    // 密钥交换使用的椭圆曲线，按优先顺序排列，如"X25519:P-256"
+    // 为空时使用OpenSSL的默认值
+    std::string groups_;
+
+    // 是否按服务端的顺序选择加密套件和椭圆曲线，否则按客户端的顺序
+    bool prefer_server_ciphers_ = false;
+
+    // DER格式的OCSP响应文件，分别对应默认证书和ECDSA证书，为空时不装订
+    // 响应缓存在内存中，握手时附带给请求证书状态的客户端
+    std::string ocsp_response_file_path_;
+    std::string ecdsa_ocsp_response_file_path_;
+
+    // 设置后所有证书的OCSP响应都通过它获取，不再读取上面的文件
+    OcspResponseProvider ocsp_response_provider_;
+
+    // 重新获取OCSP响应的最长间隔（秒），响应剩余有效期过半时也会重新获取
+    std::size_t ocsp_refresh_interval_ = 3600;
+
+    // 按SNI主机名选择的证书，启动时全部加载
+    // 客户端没有发送SNI或主机名没有匹配时使用上面的证书
+    std::vector<HostCertificate> host_certificates_;
+
+    // 写操作停滞的超时时间（秒），0表示永不超时
+    // 每次写操作都会重新计时
     std::size_t connection_timeout_ = 0;
 
+    // 长连接等待下一个请求的超时时间（秒），0表示永不超时
+    std::size_t idle_timeout_ = 60;
+
+    // 以下超时用于防御慢速攻击，在进入对应阶段时计时，0表示不限制
+    // 握手和头部阶段收到的数据不会延长期限，
+    // 只有请求体阶段会按下面的最低传输速率延长期限
+
+    // TLS握手的超时时间（秒）
+    std::size_t handshake_timeout_ = 10;
+
+    // 读取请求行和头部的超时时间（秒），从收到请求的第一个字节开始计时
+    std::size_t request_header_timeout_ = 20;
+
+    // 读取请求体的超时时间（秒），从头部解析完毕开始计时
+    std::size_t request_body_timeout_ = 20;
+
+    // 请求体的最低传输速率（字节/秒）
+    // 每收到这么多字节，请求体的超时期限延长1秒，0表示不延长
+    std::size_t request_body_min_rate_ = 500;
+
     // 服务器能接受的最大uri长度
     std::size_t uri_max_length_ = 1024;
 
     // 服务器能接受的最大request长度
     std::size_t request_max_length_ = 8388608;
 
+    // 每个连接的输出缓冲区大小
+    // 小的写操作先合并到缓冲区，缓冲区达到该大小或一批请求处理完毕时才写入socket
+    std::size_t write_buffer_size_ = 16384;
+
     // 编码类型
     EncodingType encoding_type_ = EncodingType::Brotli;
 
+    // 是否尝试在握手完成后启用kTLS，由内核加密发送的数据
+    // 内核或加密套件不支持时自动回退到OpenSSL加密
+    bool ktls_ = false;
+
+    // 是否为每个处理连接的io_context创建一个SO_REUSEPORT监听套接字
+    // 由内核分配新连接，接受连接、握手和处理请求都在同一个线程中完成
+    bool reuse_port_ = false;
+
+    // 新连接分配到io_context的策略，启用reusePort时不使用
+    PlacementPolicy placement_policy_ = PlacementPolicy::RoundRobin;
+
+    // 收到停止信号后等待正在处理的请求完成的最长时间（秒）
+    // 期间不再接受新连接，空闲的长连接立即关闭，
+    // 超时后强制关闭所有连接，0表示立即停止
+    std::size_t drain_timeout_ = 30;
+
+    // 执行ServiceExecution::WorkerPool服务的线程数，0表示使用硬件线程数
+    std::size_t worker_pool_size_ = 0;
+
+    // 监听和信号线程可以使用的CPU，为空时不绑定
+    // 与worker_cpus_错开，避免接受连接与处理请求争抢同一个核心
+    std::vector<int> acceptor_cpus_;
+
+    // 处理连接的线程依次绑定的CPU，第i个线程绑定到worker_cpus_[i % size]
+    // 为空时不绑定
+    std::vector<int> worker_cpus_;
+
+    // 以下为过载保护的限制，分为全局和每个处理连接的线程两级，0表示不限制
+    // 连接数或正在握手的连接数达到限制时暂停接受新连接，
+    // 新连接留在内核的监听队列中；正在处理的请求数达到限制时，
+    // 新请求直接得到503响应并关闭连接
+
+    // 存活的连接数
+    std::size_t max_connections_ = 0;
+    std::size_t max_connections_per_thread_ = 0;
+
+    // 正在进行TLS握手的连接数
+    std::size_t max_handshakes_ = 0;
+    std::size_t max_handshakes_per_thread_ = 0;
+
+    // 正在处理的请求数
+    std::size_t max_requests_ = 0;
+    std::size_t max_requests_per_thread_ = 0;
+
+    // 服务端缓存的TLS会话数，用于按会话ID恢复会话，所有线程共享，0表示不缓存
+    std::size_t session_cache_size_ = 20480;
+
+    // TLS会话的有效期（秒），同时限制缓存的会话和会话票据
+    std::size_t session_timeout_ = 300;
+
+    // 是否签发会话票据，客户端凭票据恢复会话，服务端不需要保存会话
+    bool session_tickets_ = true;
+
+    // 会话票据密钥的轮换周期（秒）
+    // 使用上一个密钥签发的票据仍然有效，恢复时换发新的票据
+    std::size_t session_ticket_key_rotation_ = 3600;
+
+    // 是否通过ALPN与客户端协商使用HTTP/2
+    // 客户端不支持时继续使用HTTP/1.1
+    bool http2_ = true;
+
+    // 每个HTTP/2连接同时处理的流数，超出的流被拒绝，客户端可以重试
+    std::size_t http2_max_concurrent_streams_ = 100;
+
 public:
     Option() = default;
 
@@ -42,17 +174,126 @@ public:
     std::string privateKeyPwd() const;
     void setPrivateKeyPwd(const std::string& pwd);
 
+    std::string ecdsaCrtFilePath() const;
+    void setEcdsaCrtFilePath(const std::string& path);
+
+    std::string ecdsaPrivateKeyFilePath() const;
+    void setEcdsaPrivateKeyFilePath(const std::string& path);
+
+    std::string cipherList() const;
+    void setCipherList(const std::string& ciphers);
+
+    std::string cipherSuites() const;
+    void setCipherSuites(const std::string& suites);
+
+    std::string groups() const;
+    void setGroups(const std::string& groups);
+
+    bool preferServerCiphers() const;
+    void setPreferServerCiphers(const bool enable);
+
+    std::string ocspResponseFilePath() const;
+    void setOcspResponseFilePath(const std::string& path);
+
+    std::string ecdsaOcspResponseFilePath() const;
+    void setEcdsaOcspResponseFilePath(const std::string& path);
+
+    OcspResponseProvider ocspResponseProvider() const;
+    void setOcspResponseProvider(const OcspResponseProvider& provider);
+
+    std::size_t ocspRefreshInterval() const;
+    void setOcspRefreshInterval(const std::size_t interval);
+
+    std::vector<HostCertificate> hostCertificates() const;
+    void setHostCertificates(const std::vector<HostCertificate>& certificates);
+    void addHostCertificate(const HostCertificate& certificate);
+
     std::size_t connectionTimeout() const;
     void setConnectionTimeout(const std::size_t timeout);
 
+    std::size_t idleTimeout() const;
+    void setIdleTimeout(const std::size_t timeout);
+
+    std::size_t handshakeTimeout() const;
+    void setHandshakeTimeout(const std::size_t timeout);
+
+    std::size_t requestHeaderTimeout() const;
+    void setRequestHeaderTimeout(const std::size_t timeout);
+
+    std::size_t requestBodyTimeout() const;
+    void setRequestBodyTimeout(const std::size_t timeout);
+
+    std::size_t requestBodyMinRate() const;
+    void setRequestBodyMinRate(const std::size_t rate);
+
     std::size_t uriMaxLength() const;
     void setUriMaxLength(const std::size_t l);
 
     std::size_t requestMaxLength() const;
     void setRequestMaxLength(const std::size_t l);
 
+    std::size_t writeBufferSize() const;
+    void setWriteBufferSize(const std::size_t size);
+
     EncodingType encodingType() const;
     void setEncodingType(const EncodingType& e);
+
+    bool ktls() const;
+    void setKtls(const bool enable);
+
+    bool reusePort() const;
+    void setReusePort(const bool enable);
+
+    PlacementPolicy placementPolicy() const;
+    void setPlacementPolicy(const PlacementPolicy& policy);
+
+    std::size_t drainTimeout() const;
+    void setDrainTimeout(const std::size_t timeout);
+
+    std::size_t workerPoolSize() const;
+    void setWorkerPoolSize(const std::size_t size);
+
+    std::vector<int> acceptorCpus() const;
+    void setAcceptorCpus(const std::vector<int>& cpus);
+
+    std::vector<int> workerCpus() const;
+    void setWorkerCpus(const std::vector<int>& cpus);
+
+    std::size_t maxConnections() const;
+    void setMaxConnections(const std::size_t n);
+
+    std::size_t maxConnectionsPerThread() const;
+    void setMaxConnectionsPerThread(const std::size_t n);
+
+    std::size_t maxHandshakes() const;
+    void setMaxHandshakes(const std::size_t n);
+
+    std::size_t maxHandshakesPerThread() const;
+    void setMaxHandshakesPerThread(const std::size_t n);
+
+    std::size_t maxRequests() const;
+    void setMaxRequests(const std::size_t n);
+
+    std::size_t maxRequestsPerThread() const;
+    void setMaxRequestsPerThread(const std::size_t n);
+
+    std::size_t sessionCacheSize() const;
+    void setSessionCacheSize(const std::size_t size);
+
+    std::size_t sessionTimeout() const;
+    void setSessionTimeout(const std::size_t timeout);
+
+    bool sessionTickets() const;
+    void setSessionTickets(const bool enable);
+
+    std::size_t sessionTicketKeyRotation() const;
+    void setSessionTicketKeyRotation(const std::size_t interval);
+
+    bool http2() const;
+    void setHttp2(const bool enable);
+
+    std::size_t http2MaxConcurrentStreams() const;
+    void setHttp2MaxConcurrentStreams(const std::size_t n);
 };
 
 } // namespace https_server
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace https_server {
+
+// 新连接分配到io_context的策略
+enum class PlacementPolicy
+{
+    // 轮流分配
+    RoundRobin = 0,
+
+    // 随机选择两个io_context，分配给存活连接较少的一个
+    // 开销与轮询相近，能避免长连接在个别线程上堆积
+    PowerOfTwoChoices,
+
+    // 分配给存活连接最少的io_context，需要遍历所有io_context
+    LeastConnections
+};
+
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace https_server {
+
+// 线程局部回收内存块的分配器，用于频繁创建和释放的单个对象，如连接
+// 与BufferPool一样，释放的内存块缓存在释放它的线程中，
+// 同一线程再次分配同类型的对象时直接复用，不经过malloc，也不需要加锁
+// 配合std::allocate_shared使用时，对象和shared_ptr的控制块位于同一个内存块中
+template <typename T>
+class RecyclingAllocator
+{
+public:
+    using value_type = T;
+
+    // 每个线程最多缓存的内存块数量，超出的部分直接释放
+    static constexpr std::size_t max_cached_blocks = 256;
+
+    RecyclingAllocator() noexcept = default;
+
+    template <typename U>
+    RecyclingAllocator(const RecyclingAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n)
+    {
+        if (n == 1) {
+            auto& blocks = freeList().blocks;
+            if (!blocks.empty()) {
+                void* block = blocks.back();
+                blocks.pop_back();
+                return static_cast<T*>(block);
+            }
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        if (n == 1) {
+            auto& blocks = freeList().blocks;
+            if (blocks.size() < max_cached_blocks) {
+                blocks.push_back(p);
+                return;
+            }
+        }
+        ::operator delete(p);
+    }
+
+    friend bool operator==(const RecyclingAllocator&, const RecyclingAllocator&)
+    {
+        return true;
+    }
+
+private:
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                "over-aligned types are not supported");
+
+    struct FreeList
+    {
+        // 预留全部容量，归还时push_back不会分配内存
+        FreeList() { blocks.reserve(max_cached_blocks); }
+
+        ~FreeList()
+        {
+            for (auto block: blocks)
+                ::operator delete(block);
+        }
+
+        std::vector<void*> blocks;
+    };
+
+    // 每种类型在每个线程中各有一个空闲链表
+    static FreeList& freeList()
+    {
+        thread_local FreeList free_list;
+        return free_list;
+    }
+};
+
+} // namespace https_server
\ No newline at end of file
@@ -2,42 +2,77 @@
 
 #include "request.hpp"
 #include "service.hpp"
-#include "connection.hpp"
 #include "brotli_compressor.hpp"
 #include "gzip_compressor.hpp"
 #include "no_compressor.hpp"
+#include "buffer_pool.hpp"
 
 #include <fmt/format.h>
 
 #include <random>
+#include <algorithm>
+
+#include <unistd.h>
+#include <tuple>
 
 using std::string;
 using std::unique_ptr;
 using std::make_unique;
+using asio::awaitable;
+using asio::use_awaitable;
 
 namespace https_server {
 
 RequestHandler::RequestHandler(
             std::map<const std::string, Service&>& service_maps,
+            std::map<const std::string, AsyncService&>& async_service_maps,
             const Option& opt)
     : service_maps_(service_maps),
+      async_service_maps_(async_service_maps),
+      worker_pool_(opt.workerPoolSize()),
       opt_(opt) {}
 
-void RequestHandler::handleRequest(Connection& conn, 
+void RequestHandler::drain()
+{
+    draining_.store(true, std::memory_order_relaxed);
+}
+
+bool RequestHandler::draining() const
+{
+    return draining_.load(std::memory_order_relaxed);
+}
+
+awaitable<void> RequestHandler::handleRequest(ResponseWriter& writer, 
                 const Request& req, Response& res) 
 {
     // 匹配服务
     for (auto& service_map: service_maps_) {
         if (req.path == service_map.first) {
             // 将request和response交由service自行处理
-            service_map.second.handleRequest(req, res);
-            writeResponse(conn, req, res);
-            return;
+            auto& service = service_map.second;
+            if (service.execution() == ServiceExecution::WorkerPool) {
+                // req和res属于连接，连接在协程挂起期间保持存活
+                co_await worker_pool_.asyncRun(
+                    [&service, &req, &res] { service.handleRequest(req, res); },
+                    use_awaitable);
+            } else {
+                service.handleRequest(req, res);
+            }
+            co_await writeResponse(writer, req, res);
+            co_return;
         }
     }
 
+    // 匹配协程形式的服务，在当前线程中等待其完成
+    auto it = async_service_maps_.find(req.path);
+    if (it != async_service_maps_.end()) {
+        co_await it->second.handleRequest(req, res);
+        co_await writeResponse(writer, req, res);
+        co_return;
+    }
+
     // 找不到对应方法
-    writeStockResponseWithStatus(conn, StatusCode::not_found);
+    co_await writeStockResponseWithStatus(writer, StatusCode::not_found);
 }
 
 string RequestHandler::makeMultipartDataBoundary()
@@ -172,20 +207,35 @@ bool RequestHandler::makeMultipartRangesData(
         });
 }
 
-void RequestHandler::writeMultipartRangesData(Connection& conn, 
+awaitable<void> RequestHandler::writeMultipartRangesData(ResponseWriter& writer, 
                         const Request& req, Response& res,
                         const std::string& boundary,
                         const std::string& content_type)
 {
+    // 先记录每个范围之前的分界线以及范围的偏移量和长度，
+    // 再依次异步发送分界线和范围数据
+    std::vector<std::tuple<string, size_t, size_t>> parts;
+    string tokens;
     processMultipartRangesData(
         req, res, boundary, content_type, res.content_len_,
-        [&](const string& token) { conn.doWrite(token.c_str(), token.size()); },
+        [&](const string& token) { tokens += token; },
         [&](size_t offset, size_t length) {
-            return writeContent(conn, res.content_provider_, offset, length);
+            parts.emplace_back(std::move(tokens), offset, length);
+            tokens.clear();
+            return true;
         });
+
+    for (const auto& [part_tokens, offset, length]: parts) {
+        if (!co_await writer.asyncWrite(part_tokens.c_str(), part_tokens.size()))
+            co_return;
+        if (!co_await writeContent(writer, res.content_provider_, offset, length))
+            co_return;
+    }
+
+    co_await writer.asyncWrite(tokens.c_str(), tokens.size());
 }
 
-void RequestHandler::writeResponse(Connection& conn, 
+awaitable<void> RequestHandler::writeResponse(ResponseWriter& writer, 
             const Request& req, Response& res)
 {
     if (req.ranges.empty()) {
@@ -299,11 +349,11 @@ void RequestHandler::writeResponse(Connection& conn,
         res.setHeader("Content-Length", length);
     }
 
-    if (req.getHeaderValue("Connection") == "close") {
+    if (req.getHeaderValue("Connection") == "close" || draining()) {
         res.setHeader("Connection", "close");
-    } else if (opt_.connectionTimeout() != 0) {
+    } else if (opt_.idleTimeout() != 0) {
         res.setHeader("Keep-Alive", 
-            fmt::format("timeout={}", opt_.connectionTimeout()));
+            fmt::format("timeout={}", opt_.idleTimeout()));
     }
 
 	if (!res.hasHeader("Content-Type") &&
@@ -324,24 +374,21 @@ void RequestHandler::writeResponse(Connection& conn,
 	}
 
     if (res.status == StatusCode::range_not_satisfiable) {
-        writeStockResponseWithStatus(conn, StatusCode::range_not_satisfiable);
-        return;
+        co_await writeStockResponseWithStatus(writer, StatusCode::range_not_satisfiable);
+        co_return;
     }
 
-    writeHTTPStatus(conn, res.status);
-    writeHeaders(conn, res);
+    bool with_body = req.method != "HEAD" && !res.body.empty();
+    if (!co_await writeHeadAndBody(writer, res, with_body))
+        co_return;
 
-    if (req.method != "HEAD") {
-        if (!res.body.empty()) {
-            writeContentWithoutProvider(conn, res);
-        } else if (res.content_provider_ || 
-                res.content_provider_without_length_) {
-            writeContentWithProvider(conn, req, res, boundary, content_type);
-        }
+    if (req.method != "HEAD" && res.body.empty() &&
+        (res.content_provider_ || res.content_provider_without_length_)) {
+        co_await writeContentWithProvider(writer, req, res, boundary, content_type);
     }
 }
 
-bool RequestHandler::writeContent(Connection& conn, 
+awaitable<bool> RequestHandler::writeContent(ResponseWriter& writer, 
             const ContentProvider& content_provider,
             std::size_t offset, std::size_t length)
 {
@@ -349,43 +396,61 @@ bool RequestHandler::writeContent(Connection& conn,
 
 	DataSink data_sink;
 
-	data_sink.write = [&](const char* data, std::size_t len) {
+	data_sink.write = [&](const char* data, std::size_t len) -> awaitable<bool> {
         if (data_sink.is_writable) {
-            data_sink.is_writable = conn.doWrite(data, len);
+            data_sink.is_writable = co_await writer.asyncWrite(data, len);
         }
+        co_return data_sink.is_writable;
 	};
 
-	content_provider(offset, end_offset - offset, data_sink);
+    data_sink.flush = [&]() -> awaitable<bool> {
+        if (data_sink.is_writable) {
+            data_sink.is_writable = co_await writer.flush();
+        }
+        co_return data_sink.is_writable;
+    };
+
+    data_sink.send_file = [&](int fd, std::size_t offset, 
+                            std::size_t len) -> awaitable<bool> {
+        if (data_sink.is_writable) {
+            data_sink.is_writable = co_await writer.asyncSendFile(fd, offset, len);
+        }
+        co_return data_sink.is_writable;
+    };
+
+    data_sink.is_cancelled = [&]() {
+        return !data_sink.is_writable || writer.peerClosed();
+    };
+
+	co_await content_provider(offset, end_offset - offset, data_sink);
 
-    return data_sink.is_writable;
+    co_return data_sink.is_writable;
 }
 
-void RequestHandler::writeStockResponseWithStatus(
-                    Connection& conn, const StatusCode& status)
+awaitable<void> RequestHandler::writeStockResponseWithStatus(
+                    ResponseWriter& writer, const StatusCode& status)
 {
     auto res = Response::stockResponse(status);
-    writeHTTPStatus(conn, status);
-    writeHeaders(conn, res);
-    writeContentWithoutProvider(conn, res);
+    co_await writeHeadAndBody(writer, res, true);
 }
 
-void RequestHandler::writeContentWithProvider(
-                Connection& conn, const Request& req,
+awaitable<void> RequestHandler::writeContentWithProvider(
+                ResponseWriter& writer, const Request& req,
                 Response& res, const std::string& boundary,
                 const std::string& content_type)
 {
     if (res.content_provider_) {
         if (req.ranges.empty()) {
-            writeContent(conn, res.content_provider_, 
+            co_await writeContent(writer, res.content_provider_, 
                     0, res.content_len_);
         } else if (req.ranges.size() == 1) {
             auto offsets =
                     getRangeOffsetAndLength(req, res.content_len_, 0);
             auto offset = offsets.first;
             auto length = offsets.second;
-            writeContent(conn, res.content_provider_, offset, length);
+            co_await writeContent(writer, res.content_provider_, offset, length);
         } else {
-            writeMultipartRangesData(conn, req, res, boundary, content_type);
+            co_await writeMultipartRangesData(writer, req, res, boundary, content_type);
         }
     } else if (res.content_provider_without_length_) {
         auto type = encoding_type::encodingType(req, res, opt_);
@@ -399,19 +464,19 @@ void RequestHandler::writeContentWithProvider(
             compressor = make_unique<NoCompressor>();
         }
 
-        writeContentChunked(conn, 
+        co_await writeContentChunked(writer, 
                     res.content_provider_without_length_,
                     *compressor);
     }
 }
 
-void RequestHandler::writeContentChunked(Connection& conn, 
+awaitable<void> RequestHandler::writeContentChunked(ResponseWriter& writer, 
                 const ContentProviderWithoutLength& provider,
                 Compressor& compressor)
 {
     DataSink data_sink;
 
-    data_sink.write = [&](const char* d, std::size_t l) {
+    data_sink.write = [&](const char* d, std::size_t l) -> awaitable<bool> {
         if (data_sink.is_writable && l > 0) {
             string payload;
             if (compressor.compress(d, l, false,
@@ -421,18 +486,18 @@ void RequestHandler::writeContentChunked(Connection& conn,
                     })) 
             {
                 if (!payload.empty()) {
-                    auto chunk =
-                        fmt::format("{:x}", payload.size()) + "\r\n" + payload + "\r\n";
-                    conn.doWrite(chunk.c_str(), chunk.size());
+                    data_sink.is_writable = 
+                        co_await writer.writeChunk(payload.data(), payload.size());
                 }
             } else {
                 data_sink.is_writable = false;
             }
         }
+        co_return data_sink.is_writable;
     };
 
-    data_sink.done = [&](void) {
-        if (!data_sink.is_writable) { return; }
+    data_sink.done = [&](void) -> awaitable<void> {
+        if (!data_sink.is_writable) { co_return; }
 
         std::string payload;
         if (!compressor.compress(nullptr, 0, true,
@@ -442,50 +507,62 @@ void RequestHandler::writeContentChunked(Connection& conn,
                 })) 
         {
             data_sink.is_writable = false;
-            return;
+            co_return;
         }
 
-        if (!payload.empty()) {
-            auto chunk =
-                    fmt::format("{:x}", payload.size()) + "\r\n" + payload + "\r\n";
-            conn.doWrite(chunk.c_str(), chunk.size());
+        if (!payload.empty() && 
+            !co_await writer.writeChunk(payload.data(), payload.size())) {
+            data_sink.is_writable = false;
+            co_return;
         }
 
-        static const string done_marker("0\r\n\r\n");
-        conn.doWrite(done_marker.c_str(), done_marker.size());
+        data_sink.is_writable = co_await writer.writeLastChunk();
     };
 
-    provider(data_sink);
-}
+    data_sink.flush = [&]() -> awaitable<bool> {
+        if (data_sink.is_writable) {
+            data_sink.is_writable = co_await writer.flush();
+        }
+        co_return data_sink.is_writable;
+    };
 
-void RequestHandler::writeHeaders(Connection& conn, Response& res)
-{
-    string data;
-    // 头部信息
-    for (auto& h: res.headers) {
-        data += h.name;
-        data += string(name_value_separator_, 2);
-        data += h.value;
-        data += string(crlf_, 2);
-    }
+    // 分块传输需要经过压缩和分块编码，无法使用sendfile，
+    // 读取文件后交给write处理
+    data_sink.send_file = [&](int fd, std::size_t offset, 
+                            std::size_t len) -> awaitable<bool> {
+        auto buf = BufferPool::acquire(BufferPool::large_buffer_size);
+        std::size_t end = offset + len;
+        while (data_sink.is_writable && offset < end) {
+            auto n = ::pread(fd, buf.data(), std::min(buf.size(), end - offset),
+                            static_cast<off_t>(offset));
+            if (n <= 0) {
+                data_sink.is_writable = false;
+                break;
+            }
+            if (!co_await data_sink.write(buf.data(), static_cast<std::size_t>(n)))
+                break;
+            offset += static_cast<std::size_t>(n);
+        }
+        co_return data_sink.is_writable;
+    };
 
-    // 空行
-    data += string(crlf_, 2);
+    data_sink.is_cancelled = [&]() {
+        return !data_sink.is_writable || writer.peerClosed();
+    };
 
-    conn.doWrite(data.c_str(), data.size());
+    co_await provider(data_sink);
 }
 
-void RequestHandler::writeHTTPStatus(Connection& conn, const StatusCode& status)
+awaitable<bool> RequestHandler::writeHeadAndBody(ResponseWriter& writer, 
+                const Response& res, bool with_body)
 {
-    auto data = status_code::statusToResponseHeader(status);
+    bool ok = co_await writer.writeHead(res);
 
-    conn.doWrite(data.c_str(), data.size());
-}
+    if (ok && with_body && !res.body.empty()) {
+        ok = co_await writer.asyncWrite(res.body.c_str(), res.body.size());
+    }
 
-void RequestHandler::writeContentWithoutProvider(
-        Connection& conn, Response& res)
-{
-    conn.doWrite(res.body.c_str(), res.body.size());
+    co_return ok;
 }
 
 } // namespace https_server
\ No newline at end of file
@@ -1,18 +1,23 @@
 #pragma once
 
 #include "response.hpp"
+#include "response_writer.hpp"
 #include "option.hpp"
 #include "compressor.hpp"
+#include "worker_pool.hpp"
+
+#include <asio/awaitable.hpp>
 
 #include <vector>
 #include <string>
 #include <map>
+#include <atomic>
 
 namespace https_server {
 
 class Request;
 class Service;
-class Connection;
+class AsyncService;
 
 // 所有请求的通用处理器
 class RequestHandler {
@@ -22,22 +27,33 @@ public:
 
     explicit RequestHandler(
                 std::map<const std::string, Service&>& service_maps,
+                std::map<const std::string, AsyncService&>& async_service_maps,
                 const Option& opt);
 
     // 处理请求并生成响应信息
-    void handleRequest(Connection& conn, const Request& req, Response& res);
+    asio::awaitable<void> handleRequest(ResponseWriter& writer, const Request& req, Response& res);
+
+    // 服务器即将停止，之后的响应都带有Connection: close
+    void drain();
+
+    // 服务器是否即将停止
+    bool draining() const;
 
     // 根据状态码发送响应的固定响应
-    void writeStockResponseWithStatus(Connection& conn, 
+    asio::awaitable<void> writeStockResponseWithStatus(ResponseWriter& writer, 
                             const StatusCode& status);
 
 private:
     // 服务映射
     std::map<const std::string, Service&>& service_maps_;
 
-    const char name_value_separator_[2] = {':', ' '};
+    // 协程形式的服务映射
+    std::map<const std::string, AsyncService&>& async_service_maps_;
 
-    const char crlf_[2] = {'\r', '\n'};
+    // 执行ServiceExecution::WorkerPool服务的线程池
+    WorkerPool worker_pool_;
+
+    std::atomic<bool> draining_ = false;
 
     // 配置
     const Option& opt_;
@@ -82,7 +98,7 @@ private:
                                 Token stoken, Content content);
 
     // 使用content_provider拼接多重范围数据
-    void writeMultipartRangesData(Connection& conn, 
+    asio::awaitable<void> writeMultipartRangesData(ResponseWriter& writer, 
                         const Request& req, Response& res,
                         const std::string& boundary,
                         const std::string& content_type);
@@ -95,33 +111,30 @@ private:
                                 std::string& data);
 
     // 向客户端发送响应
-    void writeResponse(Connection& conn, 
+    asio::awaitable<void> writeResponse(ResponseWriter& writer, 
                     const Request& req, Response& res);
 
     // 根据provider处理一个range
     // false 写操作发生错误;
     // true 写操作完成
-    bool writeContent(Connection& conn, 
+    asio::awaitable<bool> writeContent(ResponseWriter& writer, 
                     const ContentProvider& content_provider,
                     std::size_t offset, std::size_t length);
     
     // 根据provider将数据发送到客户端
-    void writeContentWithProvider(Connection& conn, const Request& req,
+    asio::awaitable<void> writeContentWithProvider(ResponseWriter& writer, const Request& req,
                             Response& res, const std::string& boundary,
                             const std::string& content_type);
     
-    void writeContentChunked(Connection& conn, 
+    asio::awaitable<void> writeContentChunked(ResponseWriter& writer, 
                 const ContentProviderWithoutLength& provider,
                 Compressor& compressor); 
-    
-    // 将头部信息发送到客户端
-    void writeHeaders(Connection& conn, Response& res);
-
-    // 将状态信息发送到客户端
-    void writeHTTPStatus(Connection& conn, const StatusCode& status);
 
-    // 使用body发送响应
-    void writeContentWithoutProvider(Connection& conn, Response& res);
+    // 发送状态行、头部信息以及body
+    // HTTP/1.1中body较小时与头部合并为一个TLS记录和一次系统调用
+    // with_body: 是否发送res.body
+    asio::awaitable<bool> writeHeadAndBody(ResponseWriter& writer, 
+                    const Response& res, bool with_body);
 };
 
 } // namespace https_server
\ No newline at end of file
@@ -16,6 +16,13 @@ using std::regex_match;
 
 namespace https_server {
 
+namespace {
+
+// 支持的请求方法
+const set<std::string> methods{ "GET", "HEAD", "POST"};
+
+} // namespace
+
 RequestParser::RequestParser(const Option& opt)
     : parser_state_(method_start),
       content_size_(0),
@@ -27,6 +34,23 @@ void RequestParser::reset() {
     multipart_form_data_parser_.reset();
 }
 
+std::size_t RequestParser::remainingContentLength() const
+{
+    if (parser_state_ != body_content)
+        return 0;
+    return static_cast<std::size_t>(content_size_);
+}
+
+bool RequestParser::isIdle() const
+{
+    return parser_state_ == method_start;
+}
+
+bool RequestParser::isParsingBody() const
+{
+    return parser_state_ == body_content;
+}
+
 tuple<ResultType, char*> RequestParser::parse(Request& req,
             Response& res, char* begin, char* end)
 {
@@ -53,6 +77,44 @@ tuple<ResultType, char*> RequestParser::parse(Request& req,
     return std::make_tuple(indeterminate, begin);
 }
 
+ResultType RequestParser::parseHttp2Request(Request& req, Response& res)
+{
+    if (methods.find(req.method) == methods.end()) {
+        res.status = StatusCode::not_implemented;
+        return bad;
+    }
+
+    if (req.uri.size() > opt_.uriMaxLength()) {
+        res.status = StatusCode::uri_too_long;
+        return bad;
+    }
+
+    string path = req.uri;
+    if (!UriParser::uriDecode(path, req.uri)) {
+        return bad;
+    }
+    uri_parser_.parse(req);
+
+    if (req.method != "POST" && req.hasHeader("Range")) {
+        if (!parseRangeHeader(req.getHeaderValue("Range"), req.ranges))
+            return bad;
+    }
+
+    // 解析表单数据
+    if (req.isMultipartFormData()) {
+        string boundary;
+        auto content_type = req.getHeaderValue("Content-Type");
+        if (!parseMultipartBoundary(content_type, boundary)) {
+            return bad;
+        }
+        multipart_form_data_parser_.reset();
+        multipart_form_data_parser_.setBoundary(std::move(boundary));
+        return multipart_form_data_parser_.parse(req, req.body.c_str(), req.body.size());
+    }
+
+    return good;
+}
+
 ResultType RequestParser::consume(Request& req, Response& res, char input)
 {
     // 匹配当前解析状态
@@ -67,8 +129,6 @@ ResultType RequestParser::consume(Request& req, Response& res, char input)
         }
     case method:
         if (input == ' ') {
-            // 支持的请求方法
-            static const set<std::string> methods{ "GET", "HEAD", "POST"};
             if (methods.find(req.method) == methods.end()) { 
                 res.status = StatusCode::not_implemented;
                 return bad; 
@@ -21,9 +21,25 @@ public:
     std::tuple<ResultType, char*> parse(Request& req,
             Response& res, char* begin, char* end);
 
+    // 检查并解析一个HTTP/2请求
+    // 方法、uri、头部和请求体已经从HEADERS和DATA帧中得到，
+    // 这里进行与HTTP/1.1相同的检查，并解析路径、查询参数、范围请求和表单数据
+    // 返回good或bad，bad时res.status为对应的状态码
+    ResultType parseHttp2Request(Request& req, Response& res);
+
     // 重置当前解析状态
     void reset();
 
+    // 返回尚未读取的请求体长度
+    // 当前不在解析请求体时返回0
+    std::size_t remainingContentLength() const;
+
+    // 是否尚未收到新请求的任何数据
+    bool isIdle() const;
+
+    // 是否正在解析请求体
+    bool isParsingBody() const;
+
     // 根据分隔符切割字符串
     // s: 需要切割的字符串
     // d: 分割符
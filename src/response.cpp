@@ -1,6 +1,12 @@
 #include "response.hpp"
+#include "mime_types.hpp"
 
 #include <cassert>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using std::string;
 using std::vector;
@@ -95,6 +101,53 @@ void Response::setChunkedContentProvider(const string& content_type,
     content_provider_without_length_ = provider;
 }
 
+bool Response::setFile(const string& path, const string& content_type)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    auto type = content_type;
+    if (type.empty()) {
+        auto name = path.substr(path.find_last_of('/') + 1);
+        auto pos = name.find_last_of('.');
+        type = pos == string::npos 
+            ? "application/octet-stream" 
+            : mime_types::extensionToType(name.substr(pos + 1));
+    }
+
+    return setFile(fd, type);
+}
+
+bool Response::setFile(int fd, const string& content_type)
+{
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        if (fd >= 0)
+            ::close(fd);
+        return false;
+    }
+
+    // 所有范围发送完毕，response销毁后关闭文件
+    auto file = std::shared_ptr<int>(new int(fd), [](int* p) {
+        ::close(*p);
+        delete p;
+    });
+
+    // 空文件直接使用空body响应
+    if (st.st_size == 0) {
+        setContent("", content_type);
+        return true;
+    }
+
+    setContentProvider(static_cast<std::size_t>(st.st_size), content_type,
+        [file](std::size_t offset, std::size_t length, DataSink& sink)
+            -> asio::awaitable<void> {
+            co_await sink.send_file(*file, offset, length);
+        });
+    return true;
+}
+
 Response Response::stockResponse(const StatusCode& status) {
     Response res;
     res.status = status;
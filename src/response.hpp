@@ -8,13 +8,16 @@
 #include <vector>
 #include <functional>
 
+#include <asio/awaitable.hpp>
+
 namespace https_server {
 
+// 数据供应器是一个协程，通过co_await sink.write(...)发送数据
 using ContentProvider =
-    std::function<void(std::size_t offset, std::size_t length, DataSink& sink)>;
+    std::function<asio::awaitable<void>(std::size_t offset, std::size_t length, DataSink& sink)>;
 
 using ContentProviderWithoutLength =
-    std::function<void(DataSink &sink)>;
+    std::function<asio::awaitable<void>(DataSink &sink)>;
 
 struct Response {
     // 响应消息对应的状态码
@@ -62,6 +65,17 @@ struct Response {
     void setChunkedContentProvider(const std::string& content_type, 
             ContentProviderWithoutLength provider);
 
+    // 使用文件作为响应内容
+    // Content-Length与单个、多个范围请求由RequestHandler自动处理，
+    // 文件数据通过sendfile（启用kTLS时）或pread直接发送
+    // content_type为空时根据文件扩展名推断
+    // 文件无法打开时返回false，response不做任何修改
+    bool setFile(const std::string& path, const std::string& content_type = "");
+
+    // 使用已打开的文件作为响应内容，fd的所有权转移给response
+    // fd无效时返回false
+    bool setFile(int fd, const std::string& content_type = "application/octet-stream");
+
     // 数据长度
     std::size_t content_len_;
 
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "response.hpp"
+
+#include <asio/awaitable.hpp>
+
+#include <cstddef>
+
+namespace https_server {
+
+// 响应的输出端，RequestHandler只通过它发送响应
+// HTTP/1.1由Connection实现，HTTP/2由Http2Stream实现，
+// 协议相关的部分（头部的格式、分块的编码）由实现者处理
+class ResponseWriter {
+public:
+    virtual ~ResponseWriter() = default;
+
+    // 发送状态行和头部信息
+    // 当发生错误时返回false, 反之返回true
+    virtual asio::awaitable<bool> writeHead(const Response& res) = 0;
+
+    // 发送响应体数据
+    // 当发生错误时返回false, 反之返回true
+    virtual asio::awaitable<bool> asyncWrite(const char* data, std::size_t len) = 0;
+
+    // 发送长度未知的响应体中的一段数据
+    virtual asio::awaitable<bool> writeChunk(const char* data, std::size_t len) = 0;
+
+    // 长度未知的响应体发送完毕
+    virtual asio::awaitable<bool> writeLastChunk() = 0;
+
+    // 立即发送已写入但尚未发送的数据
+    virtual asio::awaitable<bool> flush() = 0;
+
+    // 将文件fd中[offset, offset + length)范围的数据作为响应体发送
+    virtual asio::awaitable<bool> asyncSendFile(int fd, std::size_t offset, std::size_t length) = 0;
+
+    // 客户端是否已不再接收本响应
+    virtual bool peerClosed() = 0;
+};
+
+} // namespace https_server
\ No newline at end of file
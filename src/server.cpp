@@ -1,6 +1,10 @@
 #include "server.hpp"
 #include "connection.hpp"
 #include "request_handler.hpp"
+#include "ktls.hpp"
+#include "http2_session.hpp"
+#include "connection_manager.hpp"
+#include "recycling_allocator.hpp"
 
 #include <memory>
 #include <fmt/format.h>
@@ -22,30 +26,21 @@ namespace https_server {
 Server::Server(const string& address, const string& port,
     std::size_t io_context_pool_size,
     const Option& opt)
-    : address_(address),
-      port_(port),
+    : opt_(opt),
+      session_resumption_(opt),
+      ocsp_stapling_(opt),
+      admission_(opt),
       io_context_pool_(io_context_pool_size),
-      ssl_context_(asio::ssl::context::sslv23),
       signals_(io_context_pool_.get_acceptor_singals_io_context()),
-      acceptor_(io_context_pool_.get_acceptor_singals_io_context()),
-      opt_(opt),
-      req_handler_(service_maps_, opt),
-      new_connection_() {
+      reload_signals_(io_context_pool_.get_acceptor_singals_io_context()),
+      req_handler_(service_maps_, async_service_maps_, opt),
+      address_(address),
+      port_(port) {
 
-    ssl_context_.set_options(
-    context::default_workarounds | 
-    context::no_sslv2 );
+    ssl_contexts_ = makeSslContexts();
 
-    // 加载证书
-    ssl_context_.use_certificate_chain_file(opt_.crtFilePath());
-    // 加载私钥
-    ssl_context_.use_private_key_file(opt_.privateKeyFilePath(), asio::ssl::context::pem);
-    // 返回私钥密码
-    ssl_context_.set_password_callback(
-        [this](std::size_t, context::password_purpose) {
-            return opt_.privateKeyPwd();
-        }
-    );
+    io_context_pool_.set_placement_policy(opt_.placementPolicy());
+    io_context_pool_.set_cpu_affinity(opt_.acceptorCpus(), opt_.workerCpus());
 
     // 注册程序终止的信号
     signals_.add(SIGINT);
@@ -57,23 +52,172 @@ Server::Server(const string& address, const string& port,
     // 启动一个协程处理信号的响应
     co_spawn(signals_.get_executor(), doAwaitStop(), detached);
 
-    // 绑定地址和端口号
-    tcp::resolver resolver(acceptor_.get_executor());
+#if defined(SIGHUP)
+    // 注册重新加载证书的信号
+    reload_signals_.add(SIGHUP);
+    co_spawn(reload_signals_.get_executor(), doAwaitReload(), detached);
+#endif
+
+    tcp::resolver resolver(signals_.get_executor());
     tcp::endpoint endpoint = *resolver.resolve(address, port).begin();
-    acceptor_.open(endpoint.protocol());
-    // 打开地址复用选项
-    acceptor_.set_option(tcp::acceptor::reuse_address(true));
-    acceptor_.bind(endpoint);
-    acceptor_.listen();
 
-    // 启动一个协程接受端口的网络请求
-    co_spawn(acceptor_.get_executor(), doAccept(), detached);
+    if (opt_.reusePort()) {
+        // 每个线程监听同一个端口，由内核分配连接
+        for (std::size_t i = 0; i < io_context_pool_.worker_count(); ++i)
+            listen(io_context_pool_.get_worker_io_context(i), endpoint, true);
+    } else {
+        listen(io_context_pool_.get_acceptor_singals_io_context(), endpoint, false);
+    }
+
+    // 每个监听套接字启动一个协程接受端口的网络请求
+    for (std::size_t i = 0; i < acceptors_.size(); ++i)
+        co_spawn(acceptors_[i].get_executor(), doAccept(i), detached);
+}
+
+std::shared_ptr<context> Server::makeSslContext(const HostCertificate& certificate)
+{
+    auto ssl_context = std::make_shared<context>(context::sslv23);
+
+    ssl_context->set_options(
+    context::default_workarounds | 
+    context::no_sslv2 );
+
+    // 返回私钥密码，需要在加载私钥之前设置
+    ssl_context->set_password_callback(
+        [pwd = certificate.private_key_pwd](std::size_t, context::password_purpose) {
+            return pwd;
+        }
+    );
+    // 加载证书
+    ssl_context->use_certificate_chain_file(certificate.crt_file_path);
+    // 加载私钥
+    ssl_context->use_private_key_file(certificate.private_key_file_path, context::pem);
+
+    // 按密钥类型保存在不同的位置，握手时OpenSSL根据客户端支持的签名算法选择证书
+    if (!certificate.ecdsa_crt_file_path.empty()) {
+        ssl_context->use_certificate_chain_file(certificate.ecdsa_crt_file_path);
+        ssl_context->use_private_key_file(certificate.ecdsa_private_key_file_path, 
+                                        context::pem);
+    }
+
+    setupCiphers(ssl_context->native_handle());
+
+    // OCSP装订，在这里获取第一次响应，握手时只使用缓存的响应
+    ocsp_stapling_.setupContext(ssl_context->native_handle(),
+        certificate.crt_file_path, certificate.ocsp_response_file_path);
+    if (!certificate.ecdsa_crt_file_path.empty())
+        ocsp_stapling_.setupContext(ssl_context->native_handle(),
+            certificate.ecdsa_crt_file_path, certificate.ecdsa_ocsp_response_file_path);
+
+    // 会话缓存和会话票据
+    // 握手中切换上下文后，会话的查找和票据的解密仍使用默认上下文上的回调
+    session_resumption_.setupContext(ssl_context->native_handle());
+
+    // 收集启用kTLS所需的密钥信息
+    if (opt_.ktls())
+        ktls::setupContext(ssl_context->native_handle());
+
+    // 通过ALPN协商HTTP/2
+    if (opt_.http2())
+        Http2Session::setupContext(ssl_context->native_handle());
+
+    return ssl_context;
+}
+
+void Server::setupCiphers(SSL_CTX* ctx)
+{
+    // 配置无效时与加载证书失败一样抛出异常
+    auto check = [](int result, const char* what) {
+        if (result != 1) {
+            error_code ec(static_cast<int>(::ERR_get_error()), 
+                        asio::error::get_ssl_category());
+            throw std::system_error(ec, what);
+        }
+    };
+
+    if (!opt_.cipherList().empty())
+        check(::SSL_CTX_set_cipher_list(ctx, opt_.cipherList().c_str()), 
+            "SSL_CTX_set_cipher_list");
+    if (!opt_.cipherSuites().empty())
+        check(::SSL_CTX_set_ciphersuites(ctx, opt_.cipherSuites().c_str()), 
+            "SSL_CTX_set_ciphersuites");
+    if (!opt_.groups().empty())
+        check(::SSL_CTX_set1_groups_list(ctx, opt_.groups().c_str()), 
+            "SSL_CTX_set1_groups_list");
+
+    // 椭圆曲线的选择同样受该选项影响
+    if (opt_.preferServerCiphers())
+        ::SSL_CTX_set_options(ctx, SSL_OP_CIPHER_SERVER_PREFERENCE);
+}
+
+std::shared_ptr<SniContexts> Server::makeSslContexts()
+{
+    auto contexts = std::make_shared<SniContexts>(makeSslContext({"",
+        opt_.crtFilePath(), opt_.privateKeyFilePath(), opt_.privateKeyPwd(),
+        opt_.ecdsaCrtFilePath(), opt_.ecdsaPrivateKeyFilePath(),
+        opt_.ocspResponseFilePath(), opt_.ecdsaOcspResponseFilePath()}));
+
+    // 启动时加载所有主机的证书，握手时只需要查表
+    for (const auto& certificate: opt_.hostCertificates())
+        contexts->add(certificate.host_name, makeSslContext(certificate));
+
+    contexts->install();
+    return contexts;
+}
+
+std::shared_ptr<context> Server::sslContext() const
+{
+    std::lock_guard<std::mutex> lock(ssl_context_mutex_);
+    return std::shared_ptr<context>(ssl_contexts_, &ssl_contexts_->defaultContext());
+}
+
+bool Server::reloadCertificate()
+{
+    // 在锁外加载文件，不阻塞接受新连接
+    std::shared_ptr<SniContexts> ssl_contexts;
+    try {
+        ssl_contexts = makeSslContexts();
+    } catch (const std::system_error& e) {
+        fmt::print("Failed to reload certificate: {}\n", e.what());
+        return false;
+    }
+
+    // 已有的连接持有原来上下文的引用，随最后一个连接释放
+    std::lock_guard<std::mutex> lock(ssl_context_mutex_);
+    ssl_contexts_ = std::move(ssl_contexts);
+    return true;
+}
+
+SessionStats Server::sessionStats() const
+{
+    return session_resumption_.stats();
+}
+
+void Server::listen(asio::io_context& io_context, 
+            const tcp::endpoint& endpoint, bool reuse_port)
+{
+    using reuse_port_option = 
+        asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+    auto& acceptor = acceptors_.emplace_back(io_context);
+    acceptor.open(endpoint.protocol());
+    // 打开地址复用选项
+    acceptor.set_option(tcp::acceptor::reuse_address(true));
+    if (reuse_port)
+        acceptor.set_option(reuse_port_option(true));
+    // 绑定地址和端口号
+    acceptor.bind(endpoint);
+    acceptor.listen();
 }
 
 void Server::addService(const std::string& path, Service& service) {
     service_maps_.emplace(path, service);
 }
 
+void Server::addService(const std::string& path, AsyncService& service) {
+    async_service_maps_.emplace(path, service);
+}
+
 void Server::run() {
     fmt::print("Server is running...\n");
     fmt::print("The link is like https://{}:{}\n", address_, port_);
@@ -81,28 +225,158 @@ void Server::run() {
     io_context_pool_.run();
 }
 
+std::vector<std::size_t> Server::connectionCounts() const
+{
+    std::vector<std::size_t> counts;
+    for (std::size_t i = 0; i < io_context_pool_.worker_count(); ++i)
+        counts.push_back(io_context_pool_.worker_connection_count(i));
+    return counts;
+}
+
 awaitable<void> Server::doAwaitStop() {
-    // 停止所有的异步操作以关闭服务器
     co_await signals_.async_wait(use_awaitable);
+
+    if (opt_.drainTimeout() != 0) {
+        // 再次收到信号时立即停止
+        signals_.async_wait([this](const error_code& ec, int) {
+            if (!ec)
+                io_context_pool_.stop();
+        });
+
+        co_await doDrain();
+    }
+
+    // 停止所有的异步操作以关闭服务器
     io_context_pool_.stop();
     fmt::print("Bye...\n");
 }
 
-awaitable<void> Server::doAccept() {
+awaitable<void> Server::doAwaitReload() {
+    for (;;) {
+        error_code ec;
+        co_await reload_signals_.async_wait(redirect_error(use_awaitable, ec));
+        if (ec)
+            co_return;
+
+        if (reloadCertificate())
+            fmt::print("Certificate reloaded\n");
+    }
+}
+
+awaitable<void> Server::doDrain() {
+    fmt::print("Draining connections...\n");
+
+    // 停止接受新连接，监听套接字可能属于其它io_context
+    for (auto& acceptor: acceptors_) {
+        asio::post(acceptor.get_executor(), [&acceptor] {
+            error_code ignored_ec;
+            acceptor.close(ignored_ec);
+        });
+    }
+
+    // 之后的响应都带有Connection: close，并关闭空闲的连接
+    req_handler_.drain();
+    for (std::size_t i = 0; i < io_context_pool_.worker_count(); ++i) {
+        auto& io_context = io_context_pool_.get_worker_io_context(i);
+        asio::use_service<ConnectionManager>(io_context).drain();
+    }
+
+    // 等待所有连接结束或超时
+    auto deadline = std::chrono::steady_clock::now() 
+                    + std::chrono::seconds(opt_.drainTimeout());
+    asio::steady_timer timer(signals_.get_executor());
+    while (std::chrono::steady_clock::now() < deadline) {
+        std::size_t connections = 0;
+        for (auto count: connectionCounts())
+            connections += count;
+        if (connections == 0)
+            break;
+
+        timer.expires_after(std::chrono::milliseconds(100));
+        co_await timer.async_wait(use_awaitable);
+    }
+}
+
+awaitable<void> Server::doAccept(std::size_t index) {
+    auto& acceptor = acceptors_[index];
+    asio::steady_timer pause_timer(acceptor.get_executor());
+
     // 持续监听端口
     for (;;) {
-        // 重新生成一个新连接
-        new_connection_.reset(new Connection(
-            io_context_pool_.get_io_context(),
-            ssl_context_, req_handler_, 
-            opt_));
-        
         error_code ec;
-        co_await acceptor_.async_accept(new_connection_->socket(),
+
+        // 选择处理新连接的io_context
+        // 启用reusePort时连接留在监听套接字所在的io_context中
+        // 否则按分配策略依次尝试，跳过达到连接数或握手数限制的io_context
+        asio::io_context* selected = nullptr;
+        auto candidates = opt_.reusePort() ? 1 : io_context_pool_.worker_count();
+        for (std::size_t i = 0; i < candidates && !selected; ++i) {
+            auto& candidate = opt_.reusePort()
+                ? io_context_pool_.get_worker_io_context(index)
+                : io_context_pool_.get_io_context();
+            if (admission_.canAccept(asio::use_service<IoContextLoad>(candidate)))
+                selected = &candidate;
+        }
+
+        // 过载时暂停接受连接，新连接留在内核的监听队列中，
+        // 队列满后由内核拒绝，不再为其分配连接和TLS状态
+        if (!selected) {
+            pause_timer.expires_after(std::chrono::milliseconds(10));
+            co_await pause_timer.async_wait(redirect_error(use_awaitable, ec));
+            if (!acceptor.is_open())
+                co_return;
+            continue;
+        }
+        auto& io_context = *selected;
+
+        auto socket = co_await acceptor.async_accept(io_context,
                                     redirect_error(use_awaitable, ec));
-        // 启动一个连接
-        if (!ec)
-            new_connection_->start();
+        // 监听套接字已关闭，服务器即将停止
+        if (!acceptor.is_open())
+            co_return;
+
+        if (ec) {
+            // 文件描述符或内存耗尽时立即重试只会空转，等待连接释放资源后再接受
+            bool exhausted = ec == asio::error::no_descriptors ||
+                ec == std::errc::too_many_files_open_in_system ||
+                ec == asio::error::no_buffer_space || ec == asio::error::no_memory;
+            if (exhausted) {
+                fmt::print("Failed to accept connection: {}\n", ec.message());
+                pause_timer.expires_after(std::chrono::milliseconds(100));
+                co_await pause_timer.async_wait(redirect_error(use_awaitable, ec));
+                if (!acceptor.is_open())
+                    co_return;
+            }
+            continue;
+        }
+
+        // 在监听线程中计入，使接受下一个连接前的检查能看到本连接
+        auto& load = asio::use_service<IoContextLoad>(io_context);
+        admission_.addConnection(load);
+        admission_.addHandshake(load);
+
+        // 连接建立后才创建Connection，使其使用最新加载的证书
+        // Connection在其所在的线程中创建，内存来自该线程回收的内存块，
+        // 连接通常也在该线程中释放，内存块随后被下一个连接复用
+        asio::post(io_context,
+            [this, &io_context, &load, socket = std::move(socket),
+                    ssl_context = sslContext()]() mutable {
+                connection_ptr new_connection;
+                try {
+                    new_connection = std::allocate_shared<Connection>(
+                        RecyclingAllocator<Connection>(), io_context,
+                        std::move(socket), std::move(ssl_context),
+                        req_handler_, admission_, opt_);
+                } catch (const std::exception& e) {
+                    fmt::print("Failed to create connection: {}\n", e.what());
+                    admission_.removeHandshake(load);
+                    admission_.removeConnection(load);
+                    return;
+                }
+
+                // 启动一个连接
+                new_connection->start();
+            });
     }
 }
 
@@ -5,11 +5,17 @@
 #include "io_context_pool.hpp"
 #include "option.hpp"
 #include "connection.hpp"
+#include "admission_control.hpp"
+#include "session_resumption.hpp"
+#include "sni_contexts.hpp"
+#include "ocsp_stapling.hpp"
 
 #include <asio.hpp>
 #include <asio/ssl.hpp>
 
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 
@@ -27,16 +33,46 @@ public:
     // 添加对应的路径和服务
     void addService(const std::string& path, Service& service);
 
+    // 添加对应的路径和协程形式的服务
+    void addService(const std::string& path, AsyncService& service);
+
     // 执行io_context循环
     void run();
 
+    // 每个处理连接的io_context上存活的连接数，即分配新连接时使用的负载
+    std::vector<std::size_t> connectionCounts() const;
+
+    // 重新读取证书和私钥文件（包括按SNI主机名选择的证书），之后的新连接使用新的证书
+    // 已有的连接继续使用原来的证书，不会被断开
+    // 加载失败时保留原来的证书并返回false，可以在任意线程中调用
+    // 收到SIGHUP信号时也会重新加载
+    bool reloadCertificate();
+
+    // TLS会话恢复的统计，可以在任意线程中调用
+    SessionStats sessionStats() const;
+
 private:
     // 服务器的配置选项
     Option opt_;
 
     std::map<const std::string, Service&> service_maps_;
 
-    asio::ssl::context ssl_context_;
+    std::map<const std::string, AsyncService&> async_service_maps_;
+
+    // TLS会话缓存和会话票据，由所有ssl上下文共享，需要在它们之后析构
+    SessionResumption session_resumption_;
+
+    // 缓存并在后台刷新所有证书的OCSP响应
+    OcspStapling ocsp_stapling_;
+
+    // 新连接使用的默认ssl上下文和按SNI主机名选择的ssl上下文，重新加载证书时整体替换
+    std::shared_ptr<SniContexts> ssl_contexts_;
+
+    // 保护ssl_contexts_的替换和读取
+    mutable std::mutex ssl_context_mutex_;
+
+    // 过载保护，连接析构时使用，需要在io_context_pool_之后析构
+    AdmissionControl admission_;
 
     // 用于执行异步操作的io_context对象池，默认为8个
     IoContextPool io_context_pool_;
@@ -44,8 +80,12 @@ private:
     // 用于注册进程终止的通知
     asio::signal_set signals_;
 
+    // 用于注册重新加载证书的通知
+    asio::signal_set reload_signals_;
+
     // 监听连接
-    asio::ip::tcp::acceptor acceptor_;
+    // 默认只有一个监听套接字，启用Option::reusePort时每个处理连接的io_context各有一个
+    std::vector<asio::ip::tcp::acceptor> acceptors_;
 
     // 请求处理器
     RequestHandler req_handler_;
@@ -56,14 +96,35 @@ private:
     // 端口号
     const std::string port_;
 
-    // 新的连接
-    connection_ptr new_connection_;
+    // 创建监听套接字并绑定地址和端口号
+    void listen(asio::io_context& io_context, 
+        const asio::ip::tcp::endpoint& endpoint, bool reuse_port);
 
     // 执行异步监听操作
-    asio::awaitable<void> doAccept();
+    // index: 监听套接字在acceptors_中的索引
+    asio::awaitable<void> doAccept(std::size_t index);
+
+    // 按配置创建ssl上下文并加载证书和私钥，失败时抛出异常
+    std::shared_ptr<asio::ssl::context> makeSslContext(const HostCertificate& certificate);
+
+    // 按配置设置加密套件和椭圆曲线的偏好，配置无效时抛出异常
+    void setupCiphers(SSL_CTX* ctx);
+
+    // 加载默认证书和所有按主机名选择的证书，任意一个失败时抛出异常
+    std::shared_ptr<SniContexts> makeSslContexts();
+
+    // 获取新连接使用的默认ssl上下文
+    // 返回的指针同时持有整组上下文，握手时切换到的上下文在连接结束前不会被释放
+    std::shared_ptr<asio::ssl::context> sslContext() const;
 
     // 等待停止服务器的请求
     asio::awaitable<void> doAwaitStop();
+
+    // 等待重新加载证书的请求
+    asio::awaitable<void> doAwaitReload();
+
+    // 停止接受新连接，等待正在处理的请求完成，最多等待Option::drainTimeout()秒
+    asio::awaitable<void> doDrain();
 };
 
 } // namespace https_server
\ No newline at end of file
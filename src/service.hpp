@@ -3,13 +3,40 @@
 #include "request.hpp"
 #include "response.hpp"
 
+#include <asio/awaitable.hpp>
+
 namespace https_server {
 
+// 服务的执行方式
+enum class ServiceExecution
+{
+    // 在连接所在的I/O线程中直接执行，适用于快速、不会阻塞的服务
+    Inline = 0,
+
+    // 在工作线程池中执行，完成后回到连接所在的线程发送响应
+    // 适用于CPU密集或会阻塞（如读写磁盘）的服务，避免阻塞同一线程上的其它连接
+    WorkerPool
+};
+
 class Service {
 public:
     virtual ~Service() = default;
 
     virtual void handleRequest(const Request &req, Response &res) = 0;
+
+    // 返回服务的执行方式，默认在I/O线程中直接执行
+    virtual ServiceExecution execution() const { return ServiceExecution::Inline; }
+};
+
+// 协程形式的服务
+// handleRequest在连接所在的线程中执行，可以co_await定时器、文件读取、
+// 后端请求等异步操作，等待期间不阻塞同一线程上的其它连接
+// req和res在协程完成之前一直有效
+class AsyncService {
+public:
+    virtual ~AsyncService() = default;
+
+    virtual asio::awaitable<void> handleRequest(const Request &req, Response &res) = 0;
 };
 
 } // namespace https_server
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "session_cache.hpp"
+
+#include <ctime>
+
+using std::string;
+
+namespace https_server {
+
+SessionCache::SessionCache(std::size_t capacity, std::size_t shards)
+    : shard_capacity_((capacity + shards - 1) / shards)
+{
+    for (std::size_t i = 0; i < shards; ++i)
+        shards_.push_back(std::make_unique<Shard>());
+}
+
+SessionCache::~SessionCache()
+{
+    for (auto& shard: shards_) {
+        for (auto& entry: shard->lru)
+            ::SSL_SESSION_free(entry.second);
+    }
+}
+
+string SessionCache::sessionId(const SSL_SESSION* session)
+{
+    unsigned int length = 0;
+    auto id = ::SSL_SESSION_get_id(session, &length);
+    return string(reinterpret_cast<const char*>(id), length);
+}
+
+SessionCache::Shard& SessionCache::shardFor(const string& id)
+{
+    return *shards_[std::hash<string>()(id) % shards_.size()];
+}
+
+void SessionCache::add(SSL_SESSION* session)
+{
+    auto id = sessionId(session);
+    auto& shard = shardFor(id);
+
+    // 会话在锁外释放，SSL_SESSION_free可能较慢
+    SSL_SESSION* replaced = nullptr;
+    SSL_SESSION* evicted = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(id);
+        if (it != shard.index.end()) {
+            replaced = it->second->second;
+            it->second->second = session;
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        } else {
+            if (shard.lru.size() >= shard_capacity_ && !shard.lru.empty()) {
+                evicted = shard.lru.back().second;
+                shard.index.erase(shard.lru.back().first);
+                shard.lru.pop_back();
+                size_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            shard.lru.emplace_front(id, session);
+            shard.index.emplace(std::move(id), shard.lru.begin());
+            size_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (replaced)
+        ::SSL_SESSION_free(replaced);
+    if (evicted)
+        ::SSL_SESSION_free(evicted);
+}
+
+SSL_SESSION* SessionCache::find(const unsigned char* id, std::size_t length)
+{
+    string key(reinterpret_cast<const char*>(id), length);
+    auto& shard = shardFor(key);
+
+    SSL_SESSION* expired = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end())
+            return nullptr;
+
+        auto session = it->second->second;
+        if (::SSL_SESSION_get_time(session) + ::SSL_SESSION_get_timeout(session) 
+                > std::time(nullptr)) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            ::SSL_SESSION_up_ref(session);
+            return session;
+        }
+
+        // 已过期的会话直接移除
+        expired = session;
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        size_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    ::SSL_SESSION_free(expired);
+    return nullptr;
+}
+
+void SessionCache::remove(SSL_SESSION* session)
+{
+    auto id = sessionId(session);
+    auto& shard = shardFor(id);
+
+    SSL_SESSION* removed = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(id);
+        if (it == shard.index.end())
+            return;
+
+        removed = it->second->second;
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        size_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    ::SSL_SESSION_free(removed);
+}
+
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <openssl/ssl.h>
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace https_server {
+
+// 服务端TLS会话缓存，所有io_context线程共享
+// 按会话ID分片，每个分片有自己的锁和LRU链表，减少多线程握手时的锁竞争
+// 重新加载证书后新的SSL_CTX继续使用同一个缓存，已缓存的会话仍然可以恢复
+class SessionCache
+{
+public:
+    // capacity: 最多缓存的会话数，平均分配到各个分片
+    explicit SessionCache(std::size_t capacity, std::size_t shards = 16);
+
+    SessionCache(const SessionCache&) = delete;
+    SessionCache& operator=(const SessionCache&) = delete;
+
+    ~SessionCache();
+
+    // 保存会话，会话的一个引用转移给缓存
+    // 分片已满时淘汰最久未使用的会话
+    void add(SSL_SESSION* session);
+
+    // 按会话ID查找，返回的会话已增加引用计数
+    // 不存在或已过期时返回nullptr
+    SSL_SESSION* find(const unsigned char* id, std::size_t length);
+
+    // 移除会话，会话不在缓存中时不做任何操作
+    void remove(SSL_SESSION* session);
+
+    // 缓存的会话数
+    std::size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+private:
+    using Entry = std::pair<std::string, SSL_SESSION*>;
+
+    struct Shard
+    {
+        std::mutex mutex;
+
+        // 最近使用的会话在前
+        std::list<Entry> lru;
+
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    };
+
+    static std::string sessionId(const SSL_SESSION* session);
+
+    Shard& shardFor(const std::string& id);
+
+    std::size_t shard_capacity_;
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    std::atomic<std::size_t> size_ = 0;
+};
+
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "session_resumption.hpp"
+
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include <cstring>
+
+namespace https_server {
+
+namespace {
+
+// SessionResumption在SSL_CTX ex_data中的索引
+int contextIndex()
+{
+    static const int index = ::SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+// 恢复会话时，会话中记录的上下文必须与当前的相同
+const unsigned char session_id_context[] = "https_server";
+
+} // namespace
+
+SessionResumption::SessionResumption(const Option& opt)
+    : timeout_(static_cast<long>(opt.sessionTimeout())),
+      tickets_(opt.sessionTickets()),
+      ticket_key_rotation_(std::chrono::seconds(opt.sessionTicketKeyRotation()))
+{
+    if (opt.sessionCacheSize() != 0)
+        cache_ = std::make_unique<SessionCache>(opt.sessionCacheSize());
+}
+
+SessionResumption* SessionResumption::fromContext(SSL_CTX* ctx)
+{
+    return static_cast<SessionResumption*>(::SSL_CTX_get_ex_data(ctx, contextIndex()));
+}
+
+void SessionResumption::setupContext(SSL_CTX* ctx)
+{
+    ::SSL_CTX_set_ex_data(ctx, contextIndex(), this);
+    ::SSL_CTX_set_timeout(ctx, timeout_);
+    ::SSL_CTX_set_session_id_context(ctx, session_id_context, 
+                                sizeof(session_id_context) - 1);
+
+    if (cache_) {
+        // 只使用外部缓存，OpenSSL内部的缓存属于单个SSL_CTX且只有一把锁
+        ::SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER |
+            SSL_SESS_CACHE_NO_INTERNAL | SSL_SESS_CACHE_NO_AUTO_CLEAR);
+        ::SSL_CTX_sess_set_new_cb(ctx, onNewSession);
+        ::SSL_CTX_sess_set_get_cb(ctx, onGetSession);
+        ::SSL_CTX_sess_set_remove_cb(ctx, onRemoveSession);
+    } else {
+        ::SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    }
+
+    if (tickets_)
+        ::SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, onTicketKey);
+    else
+        ::SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+}
+
+void SessionResumption::recordHandshake(SSL* ssl)
+{
+    auto self = fromContext(::SSL_get_SSL_CTX(ssl));
+    if (!self)
+        return;
+
+    if (::SSL_session_reused(ssl))
+        self->resumed_handshakes_.fetch_add(1, std::memory_order_relaxed);
+    else
+        self->full_handshakes_.fetch_add(1, std::memory_order_relaxed);
+}
+
+SessionStats SessionResumption::stats() const
+{
+    SessionStats stats;
+    stats.full_handshakes = full_handshakes_.load(std::memory_order_relaxed);
+    stats.resumed_handshakes = resumed_handshakes_.load(std::memory_order_relaxed);
+    stats.cache_hits = cache_hits_.load(std::memory_order_relaxed);
+    stats.cache_misses = cache_misses_.load(std::memory_order_relaxed);
+    stats.ticket_hits = ticket_hits_.load(std::memory_order_relaxed);
+    stats.ticket_misses = ticket_misses_.load(std::memory_order_relaxed);
+    stats.cached_sessions = cache_ ? cache_->size() : 0;
+    return stats;
+}
+
+int SessionResumption::onNewSession(SSL* ssl, SSL_SESSION* session)
+{
+    auto self = fromContext(::SSL_get_SSL_CTX(ssl));
+    if (!self || !self->cache_)
+        return 0;
+
+    // 返回1表示保留了OpenSSL传入的引用
+    self->cache_->add(session);
+    return 1;
+}
+
+SSL_SESSION* SessionResumption::onGetSession(SSL* ssl, const unsigned char* id,
+                                    int length, int* copy)
+{
+    *copy = 0;
+    auto self = fromContext(::SSL_get_SSL_CTX(ssl));
+    if (!self || !self->cache_)
+        return nullptr;
+
+    // 返回的会话已增加引用计数，因此*copy为0
+    auto session = self->cache_->find(id, static_cast<std::size_t>(length));
+    if (session)
+        self->cache_hits_.fetch_add(1, std::memory_order_relaxed);
+    else
+        self->cache_misses_.fetch_add(1, std::memory_order_relaxed);
+    return session;
+}
+
+void SessionResumption::onRemoveSession(SSL_CTX* ctx, SSL_SESSION* session)
+{
+    auto self = fromContext(ctx);
+    if (self && self->cache_)
+        self->cache_->remove(session);
+}
+
+bool SessionResumption::currentTicketKey(TicketKey& key)
+{
+    auto now = clock_type::now();
+    std::lock_guard<std::mutex> lock(ticket_mutex_);
+
+    if (ticket_keys_.empty() || now - ticket_keys_.front().created >= ticket_key_rotation_) {
+        TicketKey new_key;
+        if (::RAND_bytes(new_key.name, sizeof(new_key.name)) != 1 ||
+            ::RAND_bytes(new_key.aes_key, sizeof(new_key.aes_key)) != 1 ||
+            ::RAND_bytes(new_key.hmac_key, sizeof(new_key.hmac_key)) != 1)
+            return false;
+        new_key.created = now;
+
+        // 只保留上一个密钥，更早的票据需要完整握手
+        ticket_keys_.push_front(new_key);
+        if (ticket_keys_.size() > 2) {
+            ::OPENSSL_cleanse(&ticket_keys_.back(), sizeof(TicketKey));
+            ticket_keys_.pop_back();
+        }
+    }
+
+    key = ticket_keys_.front();
+    return true;
+}
+
+bool SessionResumption::findTicketKey(const unsigned char* name, TicketKey& key,
+                                bool& current)
+{
+    // 先完成可能需要的轮换，使过期的密钥不再用于解密
+    TicketKey newest;
+    if (!currentTicketKey(newest))
+        return false;
+
+    std::lock_guard<std::mutex> lock(ticket_mutex_);
+    for (std::size_t i = 0; i < ticket_keys_.size(); ++i) {
+        if (std::memcmp(ticket_keys_[i].name, name, sizeof(key.name)) == 0) {
+            key = ticket_keys_[i];
+            current = i == 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+int SessionResumption::onTicketKey(SSL* ssl, unsigned char* key_name, unsigned char* iv,
+                            EVP_CIPHER_CTX* cipher_ctx, EVP_MAC_CTX* mac_ctx, int enc)
+{
+    auto self = fromContext(::SSL_get_SSL_CTX(ssl));
+    if (!self)
+        return -1;
+
+    TicketKey key;
+    bool current = true;
+    if (enc) {
+        // 加密新的票据
+        if (!self->currentTicketKey(key) ||
+            ::RAND_bytes(iv, EVP_MAX_IV_LENGTH) != 1)
+            return -1;
+        std::memcpy(key_name, key.name, sizeof(key.name));
+    } else if (!self->findTicketKey(key_name, key, current)) {
+        // 未知的密钥，进行完整握手
+        self->ticket_misses_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    OSSL_PARAM params[] = {
+        ::OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, 
+                                    key.hmac_key, sizeof(key.hmac_key)),
+        ::OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, 
+                                    const_cast<char*>("SHA256"), 0),
+        ::OSSL_PARAM_construct_end()
+    };
+
+    bool ok = ::EVP_MAC_CTX_set_params(mac_ctx, params) == 1 && (enc
+        ? ::EVP_EncryptInit_ex(cipher_ctx, ::EVP_aes_256_cbc(), nullptr, key.aes_key, iv) == 1
+        : ::EVP_DecryptInit_ex(cipher_ctx, ::EVP_aes_256_cbc(), nullptr, key.aes_key, iv) == 1);
+    ::OPENSSL_cleanse(&key, sizeof(key));
+    if (!ok)
+        return -1;
+
+    if (enc)
+        return 1;
+
+    // 使用上一个密钥的票据返回2，OpenSSL会用当前密钥签发新的票据
+    self->ticket_hits_.fetch_add(1, std::memory_order_relaxed);
+    return current ? 1 : 2;
+}
+
+} // namespace https_server
\ No newline at end of file
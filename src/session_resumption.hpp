@@ -0,0 +1,112 @@
+#pragma once
+
+#include "option.hpp"
+#include "session_cache.hpp"
+
+#include <openssl/ssl.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace https_server {
+
+// TLS会话恢复的统计
+struct SessionStats
+{
+    // 完整握手的次数
+    std::size_t full_handshakes = 0;
+
+    // 恢复会话的握手次数
+    std::size_t resumed_handshakes = 0;
+
+    // 按会话ID在缓存中查找的命中和未命中次数
+    std::size_t cache_hits = 0;
+    std::size_t cache_misses = 0;
+
+    // 客户端提供的会话票据能否解密，票据密钥已被轮换掉时未命中
+    std::size_t ticket_hits = 0;
+    std::size_t ticket_misses = 0;
+
+    // 缓存中的会话数
+    std::size_t cached_sessions = 0;
+};
+
+// 服务端TLS会话恢复
+// 包括按会话ID恢复使用的共享缓存，以及定期轮换密钥的会话票据
+// 同一个对象可以安装到多个SSL_CTX上，重新加载证书后已有的会话和票据仍然有效
+// 生命周期必须覆盖所有安装了它的SSL_CTX
+class SessionResumption
+{
+public:
+    explicit SessionResumption(const Option& opt);
+
+    SessionResumption(const SessionResumption&) = delete;
+    SessionResumption& operator=(const SessionResumption&) = delete;
+
+    // 为SSL_CTX安装会话缓存和会话票据的回调
+    void setupContext(SSL_CTX* ctx);
+
+    // 握手成功后调用，统计是否恢复了会话
+    // ssl所属的SSL_CTX未安装时不做任何操作
+    static void recordHandshake(SSL* ssl);
+
+    SessionStats stats() const;
+
+private:
+    using clock_type = std::chrono::steady_clock;
+
+    // 会话票据的密钥，使用AES-256-CBC加密、HMAC-SHA256认证
+    struct TicketKey
+    {
+        unsigned char name[16];
+        unsigned char aes_key[32];
+        unsigned char hmac_key[32];
+        clock_type::time_point created;
+    };
+
+    static SessionResumption* fromContext(SSL_CTX* ctx);
+
+    static int onNewSession(SSL* ssl, SSL_SESSION* session);
+
+    static SSL_SESSION* onGetSession(SSL* ssl, const unsigned char* id, 
+                            int length, int* copy);
+
+    static void onRemoveSession(SSL_CTX* ctx, SSL_SESSION* session);
+
+    static int onTicketKey(SSL* ssl, unsigned char* key_name, unsigned char* iv,
+                    EVP_CIPHER_CTX* cipher_ctx, EVP_MAC_CTX* mac_ctx, int enc);
+
+    // 返回加密新票据使用的密钥，当前密钥超过轮换周期时生成新的密钥
+    bool currentTicketKey(TicketKey& key);
+
+    // 按名称查找解密票据使用的密钥，current表示是否为当前密钥
+    bool findTicketKey(const unsigned char* name, TicketKey& key, bool& current);
+
+    // 缓存的会话数为0时不使用缓存
+    std::unique_ptr<SessionCache> cache_;
+
+    // 会话的有效期（秒）
+    long timeout_;
+
+    bool tickets_;
+
+    // 票据密钥的轮换周期
+    clock_type::duration ticket_key_rotation_;
+
+    // 当前密钥在前，之后是上一个密钥，使用上一个密钥的票据仍然可以解密，并会被更新
+    std::mutex ticket_mutex_;
+    std::deque<TicketKey> ticket_keys_;
+
+    std::atomic<std::size_t> full_handshakes_ = 0;
+    std::atomic<std::size_t> resumed_handshakes_ = 0;
+    std::atomic<std::size_t> cache_hits_ = 0;
+    std::atomic<std::size_t> cache_misses_ = 0;
+    std::atomic<std::size_t> ticket_hits_ = 0;
+    std::atomic<std::size_t> ticket_misses_ = 0;
+};
+
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "sni_contexts.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+using std::string;
+using std::string_view;
+using asio::ssl::context;
+
+namespace https_server {
+
+namespace {
+
+string toLower(string_view s)
+{
+    string result(s);
+    std::transform(result.begin(), result.end(), result.begin(),
+        [](unsigned char c) { return std::tolower(c); });
+    return result;
+}
+
+} // namespace
+
+SniContexts::SniContexts(std::shared_ptr<context> default_context)
+    : default_context_(std::move(default_context)) {}
+
+void SniContexts::add(const string& host_name, std::shared_ptr<context> ctx)
+{
+    contexts_[toLower(host_name)] = std::move(ctx);
+}
+
+void SniContexts::install()
+{
+    if (contexts_.empty())
+        return;
+
+    auto ctx = default_context_->native_handle();
+    ::SSL_CTX_set_tlsext_servername_callback(ctx, onServername);
+    ::SSL_CTX_set_tlsext_servername_arg(ctx, this);
+}
+
+context& SniContexts::defaultContext() const
+{
+    return *default_context_;
+}
+
+SSL_CTX* SniContexts::find(string_view host_name) const
+{
+    // 完全限定域名末尾的点不影响匹配
+    if (!host_name.empty() && host_name.back() == '.')
+        host_name.remove_suffix(1);
+    auto name = toLower(host_name);
+
+    auto it = contexts_.find(name);
+    if (it != contexts_.end())
+        return it->second->native_handle();
+
+    // 将第一级替换为通配符再查找一次
+    auto dot = name.find('.');
+    if (dot == 0 || dot == string::npos)
+        return nullptr;
+
+    it = contexts_.find("*" + name.substr(dot));
+    if (it != contexts_.end())
+        return it->second->native_handle();
+    return nullptr;
+}
+
+int SniContexts::onServername(SSL* ssl, int*, void* arg)
+{
+    auto self = static_cast<const SniContexts*>(arg);
+
+    auto host_name = ::SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    if (host_name == nullptr)
+        return SSL_TLSEXT_ERR_OK;
+
+    // SSL对象持有新上下文的引用，连接结束前不会被释放
+    auto ctx = self->find(host_name);
+    if (ctx != nullptr && ctx != ::SSL_get_SSL_CTX(ssl))
+        ::SSL_set_SSL_CTX(ssl, ctx);
+    return SSL_TLSEXT_ERR_OK;
+}
+
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <asio/ssl.hpp>
+
+#include <openssl/ssl.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace https_server {
+
+// 一组按SNI主机名选择的ssl上下文
+// 新连接都使用默认上下文创建，握手时由servername回调按客户端发送的主机名
+// 切换到对应的上下文，没有匹配时继续使用默认上下文
+// 创建并安装后不再修改，可以在多个线程中同时使用
+class SniContexts
+{
+public:
+    explicit SniContexts(std::shared_ptr<asio::ssl::context> default_context);
+
+    SniContexts(const SniContexts&) = delete;
+    SniContexts& operator=(const SniContexts&) = delete;
+
+    // 添加主机名对应的上下文，主机名不区分大小写
+    // "*.example.com"匹配"a.example.com"，不匹配"example.com"和"a.b.example.com"
+    // 同一个主机名添加多次时使用最后添加的上下文
+    void add(const std::string& host_name, std::shared_ptr<asio::ssl::context> context);
+
+    // 在默认上下文上安装servername回调，需要在添加完所有上下文之后调用
+    void install();
+
+    // 新连接使用的默认上下文
+    asio::ssl::context& defaultContext() const;
+
+    // 按主机名查找上下文，精确匹配优先于通配符，没有匹配时返回nullptr
+    SSL_CTX* find(std::string_view host_name) const;
+
+private:
+    static int onServername(SSL* ssl, int* alert, void* arg);
+
+    std::shared_ptr<asio::ssl::context> default_context_;
+
+    // 小写的主机名到上下文的映射，通配符以"*."开头保存
+    std::unordered_map<std::string, std::shared_ptr<asio::ssl::context>> contexts_;
+};
+
+} // namespace https_server
\ No newline at end of file
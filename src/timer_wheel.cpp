@@ -0,0 +1,205 @@
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+
+using std::error_code;
+using std::uint64_t;
+
+namespace https_server {
+
+asio::execution_context::id TimerWheel::id;
+
+TimerWheel::Entry::Entry(std::function<void()> on_expire)
+    : on_expire_(std::move(on_expire)) {}
+
+TimerWheel::Entry::~Entry()
+{
+    if (armed() && wheel_)
+        wheel_->cancel(*this);
+}
+
+TimerWheel::TimerWheel(asio::io_context& io_context)
+    : asio::execution_context::service(io_context),
+      timer_(io_context)
+{
+    // 哨兵节点指向自身表示空链表
+    for (auto& level: wheels_) {
+        for (auto& slot: level)
+            slot.prev = slot.next = &slot;
+    }
+}
+
+void TimerWheel::shutdown()
+{
+    // io_context析构时，连接可能晚于时间轮释放，
+    // 这里断开所有entry，使其析构时不再访问时间轮
+    for (auto& level: wheels_) {
+        for (auto& slot: level) {
+            while (slot.next != &slot) {
+                auto& entry = static_cast<Entry&>(*slot.next);
+                unlink(entry);
+                entry.wheel_ = nullptr;
+            }
+        }
+    }
+    size_ = 0;
+
+    error_code ignored_ec;
+    timer_.cancel(ignored_ec);
+}
+
+uint64_t TimerWheel::clockTick()
+{
+    return static_cast<uint64_t>(clock_type::now().time_since_epoch() / tick);
+}
+
+void TimerWheel::arm(Entry& entry, clock_type::duration timeout)
+{
+    // 时间轮空闲时不推进current_tick_，需要先与时钟对齐
+    if (!running_)
+        current_tick_ = std::max(current_tick_, clockTick());
+
+    // 到期时间向上取整到tick，保证不会提前到期
+    auto deadline = clock_type::now().time_since_epoch() + timeout;
+    auto expiry = std::max(current_tick_ + 1,
+        static_cast<uint64_t>((deadline + tick - clock_type::duration(1)) / tick));
+
+    if (entry.armed()) {
+        // 所在槽被处理时会按新的到期时间重新放置，不需要移动节点
+        if (expiry >= entry.slot_tick_) {
+            entry.expiry_ = expiry;
+            return;
+        }
+        unlink(entry);
+    } else {
+        entry.wheel_ = this;
+        ++size_;
+    }
+
+    entry.expiry_ = expiry;
+    insert(entry);
+
+    if (!running_)
+        scheduleTick();
+}
+
+void TimerWheel::cancel(Entry& entry)
+{
+    if (!entry.armed())
+        return;
+
+    unlink(entry);
+    --size_;
+}
+
+void TimerWheel::insert(Entry& entry)
+{
+    // 已到期的entry放入当前tick的槽，随后立即处理
+    auto expiry = std::max(entry.expiry_, current_tick_);
+    auto delta = expiry - current_tick_;
+
+    std::size_t level = 0;
+    while (level + 1 < levels && delta >= (uint64_t(1) << (slot_bits * (level + 1))))
+        ++level;
+
+    // 超出最高层范围时放入最远的槽，到时再重新放置
+    auto max_delta = (uint64_t(1) << (slot_bits * levels)) - 1;
+    if (delta > max_delta)
+        expiry = current_tick_ + max_delta;
+
+    auto shift = slot_bits * level;
+    auto& slot = wheels_[level][(expiry >> shift) & (slots_per_level - 1)];
+
+    // 高层的槽在低位全部为0的tick被下放
+    entry.slot_tick_ = expiry & ~((uint64_t(1) << shift) - 1);
+
+    entry.prev = slot.prev;
+    entry.next = &slot;
+    slot.prev->next = &entry;
+    slot.prev = &entry;
+}
+
+void TimerWheel::unlink(Node& node)
+{
+    node.prev->next = node.next;
+    node.next->prev = node.prev;
+    node.prev = node.next = nullptr;
+}
+
+void TimerWheel::splice(Node& list, Node& to)
+{
+    to.prev = to.next = &to;
+    if (list.next == &list)
+        return;
+
+    to.next = list.next;
+    to.prev = list.prev;
+    to.next->prev = &to;
+    to.prev->next = &to;
+    list.prev = list.next = &list;
+}
+
+void TimerWheel::advance()
+{
+    ++current_tick_;
+
+    // 从高层到低层依次下放，保证下放的entry能在本tick被处理
+    for (std::size_t level = levels - 1; level > 0; --level) {
+        auto shift = slot_bits * level;
+        if ((current_tick_ & ((uint64_t(1) << shift) - 1)) != 0)
+            continue;
+
+        Node pending;
+        splice(wheels_[level][(current_tick_ >> shift) & (slots_per_level - 1)], pending);
+        while (pending.next != &pending) {
+            auto& entry = static_cast<Entry&>(*pending.next);
+            unlink(entry);
+            insert(entry);
+        }
+    }
+
+    Node pending;
+    splice(wheels_[0][current_tick_ & (slots_per_level - 1)], pending);
+    while (pending.next != &pending) {
+        auto& entry = static_cast<Entry&>(*pending.next);
+        unlink(entry);
+
+        // 期间被延后的entry重新放置
+        if (entry.expiry_ > current_tick_) {
+            insert(entry);
+            continue;
+        }
+
+        // 回调中可能重设或取消其它entry，甚至释放entry本身
+        --size_;
+        auto on_expire = entry.on_expire_;
+        on_expire();
+    }
+}
+
+void TimerWheel::scheduleTick()
+{
+    running_ = true;
+    timer_.expires_at(clock_type::time_point(
+        std::chrono::duration_cast<clock_type::duration>(tick * (current_tick_ + 1))));
+    timer_.async_wait([this](const error_code& ec) {
+        if (ec) {
+            running_ = false;
+            return;
+        }
+
+        // 追上当前时钟，线程繁忙时一次可能需要前进多个tick
+        auto now = clockTick();
+        while (current_tick_ < now && size_ > 0)
+            advance();
+
+        if (size_ > 0) {
+            scheduleTick();
+        } else {
+            current_tick_ = std::max(current_tick_, now);
+            running_ = false;
+        }
+    });
+}
+
+} // namespace https_server
\ No newline at end of file
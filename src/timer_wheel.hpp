@@ -0,0 +1,116 @@
+#pragma once
+
+#include <asio.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace https_server {
+
+// 每个io_context共享的分层时间轮
+// 同一线程上所有连接的超时都由一个steady_timer驱动，
+// 设置、重设和取消超时都是O(1)的链表操作，不分配内存
+// 通过asio::use_service<TimerWheel>(io_context)获取，只能在该io_context的线程中使用
+class TimerWheel : public asio::execution_context::service
+{
+private:
+    // 双向链表节点，每个槽的哨兵节点和Entry共用
+    struct Node
+    {
+        Node* prev = nullptr;
+        Node* next = nullptr;
+    };
+
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    // 时间轮的精度
+    static constexpr std::chrono::milliseconds tick = std::chrono::milliseconds(100);
+
+    static asio::execution_context::id id;
+
+    // 嵌入在使用者对象中的定时项，析构时自动取消
+    class Entry : private Node
+    {
+    public:
+        explicit Entry(std::function<void()> on_expire);
+
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+
+        ~Entry();
+
+        // 是否已设置且尚未到期
+        bool armed() const { return next != nullptr; }
+
+    private:
+        friend class TimerWheel;
+
+        TimerWheel* wheel_ = nullptr;
+
+        // 到期的tick
+        std::uint64_t expiry_ = 0;
+
+        // 所在槽被处理的tick，不晚于expiry_
+        std::uint64_t slot_tick_ = 0;
+
+        // 到期时调用
+        std::function<void()> on_expire_;
+    };
+
+    explicit TimerWheel(asio::io_context& io_context);
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // 设置entry在timeout之后到期，已设置的entry将被重设
+    // 延后到期时间只修改entry中记录的时间，不移动链表节点
+    void arm(Entry& entry, clock_type::duration timeout);
+
+    // 取消entry，未设置时不做任何操作
+    void cancel(Entry& entry);
+
+private:
+    // 每层64个槽，4层共覆盖64^4个tick（约19天），更远的到期时间在最高层循环
+    static constexpr unsigned slot_bits = 6;
+    static constexpr std::size_t slots_per_level = 1 << slot_bits;
+    static constexpr std::size_t levels = 4;
+
+    using Level = std::array<Node, slots_per_level>;
+
+    virtual void shutdown() override;
+
+    // 当前时刻对应的tick
+    static std::uint64_t clockTick();
+
+    // 按到期时间将entry放入对应的槽
+    void insert(Entry& entry);
+
+    static void unlink(Node& node);
+
+    // 将list中的节点全部移动到to中
+    static void splice(Node& list, Node& to);
+
+    // 前进一个tick，将高层到期的槽下放，并处理最低层到期的槽
+    void advance();
+
+    // 等待下一个tick
+    void scheduleTick();
+
+    asio::steady_timer timer_;
+
+    // 各层的槽，每个槽是一个带哨兵节点的循环双向链表
+    std::array<Level, levels> wheels_;
+
+    // 已处理到的tick
+    std::uint64_t current_tick_ = 0;
+
+    // 已设置的entry数量，为0时停止驱动timer_
+    std::size_t size_ = 0;
+
+    bool running_ = false;
+};
+
+} // namespace https_server
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "worker_pool.hpp"
+
+#include <algorithm>
+
+namespace https_server {
+
+namespace {
+
+// 当前线程所属的线程池和队列索引
+thread_local WorkerPool* current_pool = nullptr;
+thread_local std::size_t current_index = 0;
+
+} // namespace
+
+WorkerPool::WorkerPool(std::size_t threads)
+    : size_(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency()))
+{
+    for (std::size_t i = 0; i < size_; ++i)
+        queues_.push_back(std::make_unique<Queue>());
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto& thread: threads_)
+        thread.join();
+}
+
+void WorkerPool::start()
+{
+    for (std::size_t i = 0; i < size_; ++i)
+        threads_.emplace_back([this, i] { workerLoop(i); });
+}
+
+void WorkerPool::submit(Task task)
+{
+    std::call_once(started_, [this] { start(); });
+
+    auto index = current_pool == this
+        ? current_index
+        : next_queue_.fetch_add(1, std::memory_order_relaxed) % size_;
+
+    // 先增加计数再放入队列，否则任务可能在计数增加之前就被取出，使计数下溢
+    // 在mutex_保护下增加计数，避免等待中的线程错过通知
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++pending_;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void WorkerPool::workerLoop(std::size_t index)
+{
+    current_pool = this;
+    current_index = index;
+
+    for (;;) {
+        Task task;
+        if (popLocal(index, task) || steal(index, task)) {
+            --pending_;
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return stopped_ || pending_ > 0; });
+        if (stopped_ && pending_ == 0)
+            break;
+    }
+}
+
+bool WorkerPool::popLocal(std::size_t index, Task& task)
+{
+    auto& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+        return false;
+
+    task = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    return true;
+}
+
+bool WorkerPool::steal(std::size_t index, Task& task)
+{
+    for (std::size_t i = 1; i < size_; ++i) {
+        auto& queue = *queues_[(index + i) % size_];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+} // namespace https_server
\ No newline at end of file
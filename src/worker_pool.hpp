@@ -0,0 +1,110 @@
+#pragma once
+
+#include <asio.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace https_server {
+
+// 执行CPU密集或会阻塞的任务的工作窃取线程池
+// 每个工作线程有自己的任务队列，空闲时从其它线程的队列中窃取任务
+// 线程在第一次提交任务时才创建
+class WorkerPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // threads为0时使用硬件线程数
+    explicit WorkerPool(std::size_t threads = 0);
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // 执行完队列中剩余的任务后退出所有线程
+    ~WorkerPool();
+
+    // 提交一个任务
+    // 在工作线程中提交时放入本线程的队列，否则依次放入各个队列
+    void submit(Task task);
+
+    // 在线程池中执行fn，完成后回到调用者的executor上继续执行
+    // 如: co_await pool.asyncRun(fn, asio::use_awaitable);
+    // fn抛出的异常将在调用者的executor上重新抛出
+    template <typename CompletionToken>
+    auto asyncRun(Task fn, CompletionToken&& token);
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // 创建工作线程
+    void start();
+
+    void workerLoop(std::size_t index);
+
+    // 从本线程的队列中按提交顺序取出任务，先提交的请求先处理
+    bool popLocal(std::size_t index, Task& task);
+
+    // 本线程队列为空时，依次从其它线程的队列中窃取最早提交的任务
+    bool steal(std::size_t index, Task& task);
+
+    std::size_t size_;
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+
+    std::vector<std::thread> threads_;
+
+    std::once_flag started_;
+
+    // 等待任务的线程在mutex_和cv_上休眠
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    // 所有队列中尚未取出的任务数
+    std::atomic<std::size_t> pending_ = 0;
+
+    bool stopped_ = false;
+
+    // 非工作线程提交任务时使用的下一个队列
+    std::atomic<std::size_t> next_queue_ = 0;
+};
+
+template <typename CompletionToken>
+auto WorkerPool::asyncRun(Task fn, CompletionToken&& token)
+{
+    return asio::async_initiate<CompletionToken, void(std::exception_ptr)>(
+        [this](auto handler, Task fn) {
+            // 保证完成之前调用者的io_context不会因没有任务而退出
+            auto work = asio::make_work_guard(asio::get_associated_executor(handler));
+            using Handler = decltype(handler);
+            auto state = std::make_shared<std::pair<Handler, decltype(work)>>(
+                std::move(handler), std::move(work));
+
+            submit([state, fn = std::move(fn)]() {
+                std::exception_ptr e;
+                try {
+                    fn();
+                } catch (...) {
+                    e = std::current_exception();
+                }
+
+                auto executor = state->second.get_executor();
+                asio::post(executor, [state, e]() {
+                    state->first(e);
+                });
+            });
+        }, token, std::move(fn));
+}
+
+} // namespace https_server
\ No newline at end of file